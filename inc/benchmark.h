@@ -0,0 +1,58 @@
+/**
+ * Tic-Tac-Toe
+ * On-console benchmark - positions, timing and the SRAM record, shared by the ROM and tools/bench_collect.c
+ **/
+#ifndef _BENCHMARK_H_
+#define _BENCHMARK_H_
+
+#include <genesis.h>
+#include <game_logic.h>
+
+#define BENCH_POSITIONS 32
+
+// what is timed - cpuTurn once per OPPONENT_TYPE, then testWin and drawGameBoardSquare (scheduling the upload only)
+enum BENCH_ROW { BENCH_CPU_TURN, BENCH_TEST_WIN = BENCH_CPU_TURN + 4, BENCH_SCHEDULE_SQUARE, BENCH_ROWS };
+
+// H40 beam timing: the H counter runs 0x00-0xB6 then jumps to 0xE4-0xFF in the blanking, and the V counter goes
+// up at 0xA5; a line is 3420 master clocks and a 68000 cycle 7 of them, PAL and NTSC alike
+#define BENCH_H_JUMP_FROM 0xB6
+#define BENCH_H_JUMP_TO 0xE4
+#define BENCH_H_STEPS (BENCH_H_JUMP_FROM + 1 + 0x100 - BENCH_H_JUMP_TO)
+#define BENCH_V_STEP_H 0xA5
+#define BENCH_LINE_CLOCKS 3420
+#define BENCH_CPU_CLOCK_DIVIDER 7
+
+// the record in SRAM, at BENCH_SRAM (byte offsets as SRAM_writeXXX takes them, after the scores of every variant and the puzzles):
+//   +0  u32 BENCH_MAGIC        +4  u16 BENCH_VERSION     +6  u16 BENCH_ROWS     +8  u16 BENCH_POSITIONS
+//   +10 u16 flags (BENCH_PAL)  +12 u32 frames it took    +16 u32 cycles of an empty sample, taken off the rest
+//   +20 per row: u32 min, avg, max cycles
+//   then per row, per position: u32 cycles
+#define BENCH_SRAM 0x100
+#define BENCH_MAGIC 0x54545442
+#define BENCH_VERSION 1
+#define BENCH_PAL 0x0001
+#define BENCH_SRAM_ROWS 20
+#define BENCH_SRAM_SAMPLES (BENCH_SRAM_ROWS + BENCH_ROWS * 12)
+#define BENCH_SRAM_SIZE (BENCH_SRAM_SAMPLES + BENCH_ROWS * BENCH_POSITIONS * 4)
+
+typedef struct
+{
+    u32 min;
+    u32 max;
+    u32 total;
+    u16 samples;
+    u32 cycles[BENCH_POSITIONS];
+} BenchResult;
+
+// the built-in positions, as the moves from an empty board with CROSS first
+extern const char* const bench_positions[BENCH_POSITIONS];
+extern const char* const bench_row_names[BENCH_ROWS];
+
+void setupBenchPosition(int index, GameBoard* board);
+// 68000 cycles between two HV counter reads less than a frame apart, both in the active display
+u32 hvCycles(u16 start, u16 end);
+void clearBenchResult(BenchResult* result);
+void addBenchSample(BenchResult* result, u32 cycles);
+u32 benchAverage(const BenchResult* result);
+
+#endif // _BENCHMARK_H_
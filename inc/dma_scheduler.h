@@ -0,0 +1,27 @@
+/**
+ * Tic-Tac-Toe
+ * Central DMA scheduler - uploads are queued here and split over as many vblanks as they need
+ **/
+#ifndef _DMA_SCHEDULER_H_
+#define _DMA_SCHEDULER_H_
+
+#include <genesis.h>
+
+// DMA bytes that fit in one vblank, and the share of it the game may use this frame (less while the music plays)
+u16 vblankDmaLimit();
+u16 dmaFrameLimit();
+// what is left of this frame's share, and of SGDK's DMA queue, after everything queued so far
+u16 dmaBytesAvailable();
+u16 dmaEntriesAvailable();
+
+// queue uploads, in order - FALSE if the schedule is full (it holds the largest scene, so this is a bug)
+bool scheduleTileMap(VDPPlane plane, const TileMap* tilemap, u16 basetile, u16 x, u16 y, u16 xm, u16 ym, u16 w, u16 h);
+bool scheduleTileMapRepeat(VDPPlane plane, const TileMap* tilemap, u16 basetile, u16 x, u16 y, u16 w, u16 h);
+bool isDmaScheduled();
+u16 scheduledDmaRequests();
+
+// once per frame: after SPR_update, and last thing before SYS_doVBlankProcess
+void updateDmaScheduler();
+void endDmaFrame();
+
+#endif // _DMA_SCHEDULER_H_
@@ -0,0 +1,128 @@
+/**
+ * Tic-Tac-Toe
+ * Game logic shared by the ROM and the host tools
+ **/
+#ifndef _GAME_LOGIC_H_
+#define _GAME_LOGIC_H_
+
+#include <genesis.h>
+
+enum SQUARE_STATE { EMPTY, NOUGHT, CROSS };
+enum OPPONENT_TYPE { PLAYER_2, CPU_EASY, CPU_MEDIUM, CPU_HARD };
+enum BOARD_SQUARE { TOP_LEFT, TOP_MIDDLE, TOP_RIGHT, CENTER_LEFT, CENTER_MIDDLE, CENTER_RIGHT, BOTTOM_LEFT, BOTTOM_MIDDLE, BOTTOM_RIGHT };
+// standard, three in a row loses, either player puts down either mark, numbers 1-9 with lines summing to 15 (odd numbers
+// for the player who started)
+enum RULE_VARIANT { RULES_STANDARD, RULES_MISERE, RULES_WILD, RULES_NUMERICAL };
+
+extern const u8 winning_lines[8][3];
+extern const u8 board_symmetries[8][9];
+
+// state of a single board - current_player holds a SQUARE_STATE, the squares hold pieces: SQUARE_STATE values (the
+// mark, not who put it down, under RULES_WILD) or the numbers 1-9 under RULES_NUMERICAL. Packed to bytes
+typedef struct
+{
+    u8 squares[9];
+    u8 current_player;
+    u8 moves_remaining;
+    u8 moves_history[9];
+} GameBoard;
+
+// exact value of a position for the side to move: n > 0 wins and n < 0 loses with |n| - 1 squares left empty, 0 draws
+// (position_values in policy_tables.c), POSITION_UNKNOWN for a position that is not in the table
+#define POSITION_UNKNOWN 127
+
+// a cpu difficulty - the search visits at most max_nodes positions per move, looks max_depth plies ahead
+// and adds 0..noise to the score of each move, so the worst case cost of a move is fixed by max_nodes
+typedef struct
+{
+    u16 max_nodes;
+    u8 max_depth;
+    u8 noise;
+} SearchLimits;
+
+// one search - all of its state is here, so several boards can be searched independently
+typedef struct
+{
+    SearchLimits limits;
+    u16 nodes;
+    bool stopped;
+    u8 squares[9];
+    u16 numbers;            // numbers on the board as bits (RULES_NUMERICAL)
+    u8 piece;               // what to put down on the square searchMove returns
+    s16 score;              // and the search's score for it (before noise), -SEARCH_INFINITY if not searched
+} SearchContext;
+
+// what differs between the rule variants - each is its own copy of the search and line test (inc/rule_variant.h),
+// picked once per call so nothing in the search loops looks at game_rules
+typedef struct
+{
+    bool line_loses;
+    bool (*testWin)(GameBoard* board);
+    int (*searchMove)(SearchContext* context, GameBoard* board);
+    u8 (*nextPiece)(GameBoard* board, u8 piece);
+    // 68000 cycles of a searchMove outside its nodes (noise included), and most of one node with the
+    // nodes under it cut off - measured over every depth, node cap and noise (tools/search_bench.c)
+    u16 search_cycles;
+    u16 node_cycles;
+} RuleVariant;
+
+// search scores for the side to move: a win beats any line count, sooner wins score more
+#define SEARCH_WIN 100
+#define SEARCH_INFINITY 1000
+
+extern const u8 square_lines[9];
+extern const u8 search_order[9];
+extern const RuleVariant rule_variants[4];
+extern const SearchLimits default_difficulty_limits[4];
+
+// current state
+extern enum OPPONENT_TYPE game_opponent;
+extern enum RULE_VARIANT game_rules;
+extern SearchLimits difficulty_limits[4];
+
+// estimated 68000 cycles of the game logic, counted by host tools built with -DLOGIC_COST_MODEL
+#ifdef LOGIC_COST_MODEL
+extern u32 logic_cycles;
+#define LOGIC_COST(cycles) (logic_cycles += (cycles))
+#else
+#define LOGIC_COST(cycles)
+#endif
+
+// general
+int randomRange(int min, int max);
+bool randTest(int percentage);
+
+// game logic
+int countTilesOnWinLine(GameBoard* board, int line_index, enum SQUARE_STATE state);
+
+void clearBoard(GameBoard* board);
+bool placePiece(GameBoard* board, int square);
+bool placeMove(GameBoard* board, int square, u8 piece);
+void nextPlayer(GameBoard* board);
+bool testWin(GameBoard* board);
+enum SQUARE_STATE lineWinner(GameBoard* board);
+u8 nextPiece(GameBoard* board, u8 piece);
+u16 boardNumbers(const u8* squares);
+
+u16 canonicalPosition(const u8* board, enum SQUARE_STATE player, int* symmetry);
+int findPosition(u16 code);
+
+int randomMove(GameBoard* board);
+bool takeWin(GameBoard* board, int* squareIndex, enum SQUARE_STATE player);
+bool stopLoss(GameBoard* board, int* squareIndex, enum SQUARE_STATE player);
+bool addToWinnableLine(GameBoard* board, int* squareIndex, enum SQUARE_STATE player);
+bool blockLoseableLine(GameBoard* board, int* squareIndex, enum SQUARE_STATE player);
+bool bestSquare(const u8* values, int* squareIndex);
+int cpuTurn(GameBoard* board);
+int cpuMove(GameBoard* board, u8* piece);
+
+// bounded search under game_rules, difficulty_limits is indexed by OPPONENT_TYPE
+void resetDifficultyLimits();
+int searchMove(SearchContext* context, GameBoard* board);
+u32 searchCycles(u16 nodes);
+u32 searchWorstCase(const SearchLimits* limits);
+
+// exact values, looked up per canonical position
+s8 moveValue(GameBoard* board, int square);
+
+#endif // _GAME_LOGIC_H_
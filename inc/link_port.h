@@ -0,0 +1,19 @@
+/**
+ * Tic-Tac-Toe
+ * Serial link on controller port 2, for link play between two consoles
+ **/
+#ifndef _LINK_PORT_H_
+#define _LINK_PORT_H_
+
+#include <genesis.h>
+
+// switch port 2 from the pad to 4800 baud serial, and back
+void startLinkPort();
+void stopLinkPort();
+
+// next byte received, FALSE when there is none
+bool linkPortRead(u8* byte);
+// queue a byte to send, FALSE when the queue is full
+bool linkPortWrite(u8 byte);
+
+#endif // _LINK_PORT_H_
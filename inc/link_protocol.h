@@ -0,0 +1,75 @@
+/**
+ * Tic-Tac-Toe
+ * Lockstep protocol of link play, shared by the ROM and the host simulator
+ **/
+#ifndef _LINK_PROTOCOL_H_
+#define _LINK_PROTOCOL_H_
+
+#include <genesis.h>
+#include <game_logic.h>
+
+// buttons as sent over the link (the low bits match SGDK's BUTTON_UP..BUTTON_RIGHT)
+#define LINK_UP 0x01
+#define LINK_DOWN 0x02
+#define LINK_LEFT 0x04
+#define LINK_RIGHT 0x08
+#define LINK_A 0x10
+#define LINK_C 0x20
+
+// frames between sampling a pad and the lockstep frame that uses it
+#define LINK_INPUT_DELAY 2
+// frames of input that can be in flight, and kept for the peer (a power of 2)
+#define LINK_WINDOW 16
+#define LINK_BUFFER 32
+// frames without a byte from the peer before the link counts as lost
+#define LINK_TIMEOUT_FRAMES 180
+
+enum LINK_STATE { LINK_HELLO, LINK_PLAYING, LINK_LOST };
+enum LINK_ACTION { LINK_NONE, LINK_CURSOR, LINK_TAKE, LINK_NEXT_GAME, LINK_QUIT };
+
+// one end of a link - everything the protocol keeps, so the simulator can run two of them
+typedef struct
+{
+    u8 state;
+    u8 nonce;               // 1..63, the larger one plays CROSS
+    u8 remote_nonce;        // 0 until the peer's hello is in
+    bool cross;
+    u8 input_delay;
+
+    u16 frame;              // frames since startLink
+    u16 send_frame;         // input bytes sent
+    u16 remote_count;       // input bytes received
+    u16 sim_frame;          // next lockstep frame
+    u8 local_inputs[LINK_BUFFER];
+    u8 remote_inputs[LINK_BUFFER];
+    u8 last_inputs[2];      // cross, nought - for the presses of the next frame
+
+    // round trip timing, a single bit passed back and forth
+    u8 token_in;
+    u16 token_frame;
+    u16 rtt;
+    u16 rtt_max;
+
+    // instrumentation
+    u16 silent_frames;
+    u16 stall_frames;
+    u16 last_sim_frame;
+    u32 bytes_sent;
+    u32 bytes_received;
+} LinkSession;
+
+void startLink(LinkSession* link, u8 input_delay);
+// once a frame: the byte to send for the local pad (LINK_* bits), -1 when nothing can be sent
+s16 linkSend(LinkSession* link, u8 buttons);
+void linkReceive(LinkSession* link, u8 byte);
+// the next lockstep frame, pressed[0] / [1] are the new presses of CROSS / NOUGHT; FALSE while the peer's input is not in
+bool linkStep(LinkSession* link, u8* pressed);
+bool isLocalTurn(LinkSession* link, GameBoard* board);
+// where the local cursor ends up once the lockstep has run the local inputs already sent, from its square now
+u8 linkPredictCursor(LinkSession* link, GameBoard* board, u8 square);
+
+// what one lockstep frame does to the game - identical on both consoles
+u8 cursorMove(u8 square, u8 pressed);
+enum LINK_ACTION linkAction(GameBoard* board, bool game_over, const u8* pressed, u8* square);
+
+#endif // _LINK_PROTOCOL_H_
@@ -0,0 +1,23 @@
+/**
+ * Tic-Tac-Toe
+ * Draw-in animation of the pieces, streamed to plane A within the DMA scheduler's per-frame budget
+ **/
+#ifndef _PIECE_ANIM_H_
+#define _PIECE_ANIM_H_
+
+#include <genesis.h>
+
+// frame on which each cell of the 8x8 tile piece images appears
+extern const u8 cross_reveal[64];
+extern const u8 nought_reveal[64];
+
+// start revealing an 8x8 tile image at x, y (tiles) on plane A, replacing any animation already there
+void startPieceAnim(u16 x, u16 y, const Image* image, u16 basetile, const u8* reveal);
+void stopPieceAnim(u16 x, u16 y);
+void stopPieceAnims();
+bool isPieceAnimRunning();
+
+// once per frame, after updateDmaScheduler - holds off while scheduled uploads are pending
+void updatePieceAnims();
+
+#endif // _PIECE_ANIM_H_
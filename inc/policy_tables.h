@@ -0,0 +1,18 @@
+/**
+ * Tic-Tac-Toe
+ * Canonical position tables - generated by tools/policy_train.c, do not edit
+ **/
+#ifndef _POLICY_TABLES_H_
+#define _POLICY_TABLES_H_
+
+#include <genesis.h>
+
+#define POLICY_POSITIONS 627
+
+// canonicalPosition() codes, sorted
+extern const u16 policy_positions[POLICY_POSITIONS];
+
+// exact value of each for the side to move (see POSITION_UNKNOWN in game_logic.h)
+extern const s8 position_values[POLICY_POSITIONS];
+
+#endif // _POLICY_TABLES_H_
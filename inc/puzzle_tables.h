@@ -0,0 +1,20 @@
+/**
+ * Tic-Tac-Toe
+ * "Win in N" puzzles - generated by tools/puzzle_gen.c, do not edit
+ **/
+#ifndef _PUZZLE_TABLES_H_
+#define _PUZZLE_TABLES_H_
+
+#include <genesis.h>
+#include <puzzles.h>
+
+#define PUZZLE_COUNT 304
+
+// index of the first puzzle won in 1..PUZZLE_MAX_WIN_IN moves, then PUZZLE_COUNT
+extern const u16 puzzle_first[PUZZLE_MAX_WIN_IN + 1];
+
+// packed as in puzzles.h, by N then position
+extern const u32 puzzle_boards[PUZZLE_COUNT];
+extern const u16 puzzle_lines[PUZZLE_COUNT];
+
+#endif // _PUZZLE_TABLES_H_
@@ -0,0 +1,40 @@
+/**
+ * Tic-Tac-Toe
+ * "Win in N" puzzles, shared by the ROM and tools/puzzle_gen.c
+ **/
+#ifndef _PUZZLES_H_
+#define _PUZZLES_H_
+
+#include <genesis.h>
+#include <game_logic.h>
+
+// most moves of CROSS a puzzle can take to win - the line of CROSS moves and replies is 2 * N - 1 long
+#define PUZZLE_MAX_WIN_IN 4
+#define PUZZLE_MAX_LINE (PUZZLE_MAX_WIN_IN * 2 - 1)
+
+// a packed puzzle is a u32 and a u16:
+//   board bits 0-17   the squares, 2 bits each from square 0 up (SQUARE_STATE values), CROSS to move
+//   board bits 18-19  N - 1
+//   board bits 20-31  the first 3 moves of the line, a nibble each
+//   line bits 0-15    moves 4-7 of the line, 0xF past the end
+#define PUZZLE_WIN_IN_SHIFT 18
+#define PUZZLE_MOVES_SHIFT 20
+
+// a puzzle being played - the squares and the line as shown, under one of the board symmetries
+typedef struct
+{
+    u8 squares[9];
+    u8 moves[PUZZLE_MAX_LINE];  // CROSS's winning moves and the defence's replies, in turn
+    u8 length;
+    u8 step;                    // next move of the line
+    u8 win_in;
+} Puzzle;
+
+void decodePuzzle(u32 board, u16 line, int symmetry, Puzzle* puzzle);
+void setupPuzzleBoard(const Puzzle* puzzle, GameBoard* board);
+// TRUE if square is the next move of the line, which then moves past it
+bool checkPuzzleMove(Puzzle* puzzle, int square);
+// the defence's reply to the move just checked, -1 once the line is played out
+int puzzleReply(Puzzle* puzzle);
+
+#endif // _PUZZLES_H_
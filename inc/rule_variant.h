@@ -0,0 +1,253 @@
+/**
+ * Tic-Tac-Toe
+ * Line test and cpu search of one rule variant
+ *
+ * Included by game_logic.c once per RULE_VARIANT (and by tools/variant_bench.c),
+ * with the rules given as macros, so each variant gets its own copy of the hot
+ * loops with its line test and move generation compiled in. Define before
+ * including:
+ *
+ *   RULES_NAME                      suffix of the functions made (testWinMisere, searchMoveMisere, ...)
+ *   RULES_LINE(a, b, c)             TRUE if the pieces of a line through the last move make it a line
+ *   RULES_LINE_COST                 68000 cycles of one RULES_LINE
+ *   RULES_LINE_LOSES                1 if making a line loses the game
+ *   RULES_MIN_MOVES                 moves before the first line is possible
+ *   RULES_MAX_PIECES                most pieces the side to move can choose from
+ *   RULES_FIRST_PIECE(player, numbers, empties)
+ *   RULES_NEXT_PIECE(piece, numbers)
+ *                                   the pieces the side to move can put down, 0 after the last
+ *   RULES_PIECE_COST                68000 cycles of one RULES_NEXT_PIECE
+ *   RULES_NUMBERS                   1 if the search has to keep SearchContext.numbers
+ *
+ * and a s16 evaluate<RULES_NAME>(SearchContext*, enum SQUARE_STATE player, int empties) for the score of
+ * a position at the depth limit. The macros are undefined again at the end.
+ **/
+#define RULES_PASTE(name, variant) name##variant
+#define RULES_EXPAND(name, variant) RULES_PASTE(name, variant)
+#define RULES_FN(name) RULES_EXPAND(name, RULES_NAME)
+
+bool RULES_FN(completesLine)(const u8* squares, int square)
+{
+    u8 lines = square_lines[square];
+    LOGIC_COST(50);
+
+    // only the 2 to 4 lines through the square just taken
+    for (int l=0; l<8; l++)
+    {
+        LOGIC_COST(24);
+        if (!(lines & (1 << l))) continue;
+
+        LOGIC_COST(RULES_LINE_COST);
+        const u8* line = winning_lines[l];
+        if (RULES_LINE(squares[line[0]], squares[line[1]], squares[line[2]])) return TRUE;
+    }
+    return FALSE;
+}
+
+bool RULES_FN(testWin)(GameBoard* board)
+{
+    // not enough moves for a line
+    LOGIC_COST(40);
+    if (board->moves_remaining > 9 - RULES_MIN_MOVES) return FALSE;
+
+    // a line has to run through the last move
+    return RULES_FN(completesLine)(board->squares, board->moves_history[8 - board->moves_remaining]);
+}
+
+u8 RULES_FN(nextPiece)(GameBoard* board, u8 piece)
+{
+    // (wild pieces do not depend on the board at all)
+    (void)board;
+
+    // (the numbers on the board are only worked out for the rules that have them)
+    if (piece == 0) return RULES_FIRST_PIECE(board->current_player, RULES_NUMBERS ? boardNumbers(board->squares) : 0, board->moves_remaining);
+    return RULES_NEXT_PIECE(piece, RULES_NUMBERS ? boardNumbers(board->squares) : 0);
+}
+
+s16 RULES_FN(searchNode)(SearchContext* context, enum SQUARE_STATE player, int empties, int depth, s16 alpha, s16 beta);
+
+s16 RULES_FN(scoreMove)(SearchContext* context, int square, u8 piece, enum SQUARE_STATE player, int empties, int depth, s16 alpha, s16 beta)
+{
+    s16 score;
+    LOGIC_COST(110);    // call, make / unmake, the empties and depth checks
+
+    context->nodes++;
+    context->squares[square] = piece;
+    if (RULES_NUMBERS) context->numbers |= 1 << piece;
+
+    if (RULES_FN(completesLine)(context->squares, square)) score = RULES_LINE_LOSES ? -(SEARCH_WIN + empties - 1) : SEARCH_WIN + empties - 1;
+    else if (empties == 1) score = 0;
+    else score = -RULES_FN(searchNode)(context, player == CROSS ? NOUGHT : CROSS, empties - 1, depth - 1, -beta, -alpha);
+
+    context->squares[square] = EMPTY;
+    if (RULES_NUMBERS) context->numbers &= ~(1 << piece);
+    return score;
+}
+
+s16 RULES_FN(searchNode)(SearchContext* context, enum SQUARE_STATE player, int empties, int depth, s16 alpha, s16 beta)
+{
+    s16 best = -SEARCH_INFINITY;
+    LOGIC_COST(80);
+
+    // negamax with alpha-beta down to the depth of this iteration
+    if (depth <= 0) return RULES_FN(evaluate)(context, player, empties);
+
+    for (int i=0; i<9; i++)
+    {
+        LOGIC_COST(40);
+        int square = search_order[i];
+        if (context->squares[square] != EMPTY) continue;
+
+        for (u8 piece = RULES_FIRST_PIECE(player, context->numbers, empties); piece; piece = RULES_NEXT_PIECE(piece, context->numbers))
+        {
+            LOGIC_COST(RULES_PIECE_COST);
+
+            // out of nodes - the iteration is thrown away, so the score does not matter
+            if (context->nodes >= context->limits.max_nodes)
+            {
+                context->stopped = TRUE;
+                return 0;
+            }
+
+            s16 score = RULES_FN(scoreMove)(context, square, piece, player, empties, depth, alpha, beta);
+            if (score > best) best = score;
+            if (best > alpha) alpha = best;
+            if (alpha >= beta) return best;
+        }
+    }
+
+    return best;
+}
+
+int RULES_FN(searchMove)(SearchContext* context, GameBoard* board)
+{
+    u8 squares[9];
+    u8 pieces[RULES_MAX_PIECES];
+    u8 move_squares[9 * RULES_MAX_PIECES];
+    u8 move_pieces[9 * RULES_MAX_PIECES];
+    s16 scores[9 * RULES_MAX_PIECES];
+    int square_count = 0;
+    int piece_count = 0;
+    int move_count = 0;
+    s16 best = -SEARCH_INFINITY;
+    int move = -1;
+    LOGIC_COST(200);    // call, copying the squares
+
+    for (int i=0; i<9; i++) context->squares[i] = board->squares[i];
+    context->numbers = RULES_NUMBERS ? boardNumbers(board->squares) : 0;
+    context->nodes = 0;
+    context->stopped = FALSE;
+
+    // every move at the root - each round gives every empty square (in search order) a different piece, so
+    // the first moves tried cover the whole board whatever the pieces. With noise the pieces start at random.
+    for (int i=0; i<9; i++)
+    {
+        LOGIC_COST(30);
+        if (context->squares[search_order[i]] == EMPTY) squares[square_count++] = search_order[i];
+    }
+    for (u8 piece = RULES_FIRST_PIECE(board->current_player, context->numbers, board->moves_remaining); piece; piece = RULES_NEXT_PIECE(piece, context->numbers))
+    {
+        LOGIC_COST(RULES_PIECE_COST);
+        pieces[piece_count++] = piece;
+    }
+    int offset = (context->limits.noise && (piece_count > 1)) ? randomRange(0, piece_count - 1) : 0;
+    for (int round=0; round<piece_count; round++)
+    {
+        for (int i=0; i<square_count; i++)
+        {
+            LOGIC_COST(40);
+            move_squares[move_count] = squares[i];
+            move_pieces[move_count] = pieces[(i + round + offset) % piece_count];
+            scores[move_count] = -SEARCH_INFINITY;
+            move_count++;
+        }
+    }
+
+    // iterative deepening - every move is scored one ply deeper each time round until the depth limit
+    // or the node cap, and an iteration cut short by the cap is dropped. The first iteration is kept,
+    // and always has a move on every empty square, so a move costs at most max_nodes nodes, or one per
+    // empty square if that is more, however many pieces there are to choose from.
+    for (int depth=1; (depth <= context->limits.max_depth) && (depth <= board->moves_remaining); depth++)
+    {
+        s16 iteration[9 * RULES_MAX_PIECES];
+        s16 iteration_best = -SEARCH_INFINITY;
+        int iteration_move = -1;
+        LOGIC_COST(120);
+
+        for (int i=-1; i<move_count; i++)
+        {
+            LOGIC_COST(40);
+            // the best move of the last iteration goes first, it makes the best cutoffs
+            int m = i < 0 ? move : i;
+            if ((m < 0) || ((i >= 0) && (m == move))) continue;
+
+            // the first iteration keeps what it has once every square has a move, the rest go unscored
+            if ((depth == 1) && (i >= square_count) && (context->nodes >= context->limits.max_nodes))
+            {
+                for (; i<move_count; i++) iteration[i] = -SEARCH_INFINITY;
+                break;
+            }
+            if ((depth > 1) && (context->nodes >= context->limits.max_nodes)) context->stopped = TRUE;
+            if (context->stopped) break;
+
+            // with noise every move needs its own score, otherwise only the ones that could be better
+            s16 alpha = context->limits.noise ? -SEARCH_INFINITY : iteration_best;
+            iteration[m] = RULES_FN(scoreMove)(context, move_squares[m], move_pieces[m], board->current_player, board->moves_remaining, depth, alpha, SEARCH_INFINITY);
+            if (iteration[m] > iteration_best)
+            {
+                iteration_best = iteration[m];
+                iteration_move = m;
+            }
+        }
+        if (context->stopped) break;
+
+        for (int i=0; i<move_count; i++) scores[i] = iteration[i];
+        best = iteration_best;
+        move = iteration_move;
+
+        // a forced win will not get any better
+        if (best >= SEARCH_WIN) break;
+    }
+
+    if (move < 0)
+    {
+        // not searched at all (no depth) - any move will do
+        move = randomRange(0, move_count - 1);
+    }
+    else if (context->limits.noise)
+    {
+        // noise spreads the scores, so the weaker levels sometimes prefer a worse move
+        best = -SEARCH_INFINITY;
+        for (int i=0; i<move_count; i++)
+        {
+            LOGIC_COST(20);
+            if (scores[i] == -SEARCH_INFINITY) continue;
+
+            LOGIC_COST(40);
+            s16 score = scores[i] + randomRange(0, context->limits.noise);
+            if (score > best)
+            {
+                best = score;
+                move = i;
+            }
+        }
+    }
+
+    context->piece = move_pieces[move];
+    context->score = scores[move];
+    return move_squares[move];
+}
+
+#undef RULES_NAME
+#undef RULES_LINE
+#undef RULES_LINE_COST
+#undef RULES_LINE_LOSES
+#undef RULES_MIN_MOVES
+#undef RULES_MAX_PIECES
+#undef RULES_FIRST_PIECE
+#undef RULES_NEXT_PIECE
+#undef RULES_PIECE_COST
+#undef RULES_NUMBERS
+#undef RULES_FN
+#undef RULES_EXPAND
+#undef RULES_PASTE
@@ -0,0 +1,77 @@
+/**
+ * Tic-Tac-Toe
+ * On-console benchmark
+ *
+ * The ROM times cpuTurn, testWin and drawGameBoardSquare over the positions here
+ * with the VDP HV counter, one sample a frame, each started as the active display
+ * begins so no interrupt lands inside it. The results go on screen and into SRAM,
+ * where tools/bench_collect.c reads them and sets them against the LOGIC_COST
+ * estimates for the same positions.
+ **/
+#include <genesis.h>
+#include <game_logic.h>
+#include <benchmark.h>
+
+// random games, 0 to 7 moves in, none over
+const char* const bench_positions[BENCH_POSITIONS] = {
+    "", "0", "2", "5", "6", "02", "12", "50", "83",
+    "071", "147", "316", "608", "670",
+    "1568", "2167", "3062", "3607", "4716",
+    "10637", "31648", "75213", "75632", "86724",
+    "124603", "126537", "284016", "564387",
+    "3518274", "4827530", "6473280", "7125640"
+};
+
+// indexed by BENCH_ROW
+const char* const bench_row_names[BENCH_ROWS] = { "PLAYER 2", "CPU EASY", "CPU MEDIUM", "CPU HARD", "TESTWIN", "SCHEDULE SQ" };
+
+
+void setupBenchPosition(int index, GameBoard* board)
+{
+    clearBoard(board);
+    board->current_player = CROSS;
+
+    for (const char* move = bench_positions[index]; *move; move++)
+    {
+        placePiece(board, *move - '0');
+        nextPlayer(board);
+    }
+}
+
+static u32 beamSteps(u16 hv)
+{
+    u16 v = hv >> 8;
+    u16 h = hv & 0xFF;
+
+    // the steps of the line in order, then counted from where the V counter went up
+    if (h >= BENCH_H_JUMP_TO) h -= BENCH_H_JUMP_TO - BENCH_H_JUMP_FROM - 1;
+    return (u32)v * BENCH_H_STEPS + ((h + BENCH_H_STEPS - BENCH_V_STEP_H) % BENCH_H_STEPS);
+}
+
+u32 hvCycles(u16 start, u16 end)
+{
+    u32 steps = beamSteps(end) - beamSteps(start);
+    return steps * BENCH_LINE_CLOCKS / (BENCH_H_STEPS * BENCH_CPU_CLOCK_DIVIDER);
+}
+
+void clearBenchResult(BenchResult* result)
+{
+    result->min = 0xFFFFFFFF;
+    result->max = 0;
+    result->total = 0;
+    result->samples = 0;
+}
+
+void addBenchSample(BenchResult* result, u32 cycles)
+{
+    if (result->samples < BENCH_POSITIONS) result->cycles[result->samples] = cycles;
+    result->samples++;
+    result->total += cycles;
+    if (cycles < result->min) result->min = cycles;
+    if (cycles > result->max) result->max = cycles;
+}
+
+u32 benchAverage(const BenchResult* result)
+{
+    return result->samples ? result->total / result->samples : 0;
+}
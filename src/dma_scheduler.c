@@ -0,0 +1,226 @@
+/**
+ * Tic-Tac-Toe
+ * Central DMA scheduler
+ *
+ * Screen building used to DMA whole tilemaps the moment they were drawn, while the
+ * XGM driver on the Z80 was reading music data from ROM over the same bus. Now the
+ * uploads are queued as requests and, once per frame, as much of them as fits in
+ * what is left of vblank is moved to SGDK's DMA queue (tile maps by rows); the rest
+ * waits for the next frame. The size of SGDK's queue is the ledger, so anything
+ * else queued this frame (sprites, piece animations) is counted.
+ *
+ * While the music plays a quarter of vblank is left to the driver and SGDK is told
+ * to hold DMA until the driver has done its vblank work (XGM_setForceDelayDMA), so
+ * the music never waits on a transfer.
+ **/
+#include <genesis.h>
+#include <dma_scheduler.h>
+
+// DMA bytes per vblank in H40 (the same figures as SGDK's DMA_TRANSFER_CAPACITY_NTSC / _PAL)
+const u16 VBLANK_DMA_NTSC = 7200;
+const u16 VBLANK_DMA_PAL = 15000;
+
+// stay well inside SGDK's DMA queue (80 entries by default)
+const u16 DMA_QUEUE_ENTRIES = 64;
+
+// a whole scene is scheduled at once - the largest is the simul screen: background, both score
+// panels and the 36 squares of the mini boards (39 requests)
+#define MAX_DMA_REQUESTS 40
+
+enum DMA_REQUEST_TYPE { DMA_REQUEST_TILEMAP, DMA_REQUEST_TILEMAP_REPEAT };
+
+typedef struct
+{
+    enum DMA_REQUEST_TYPE type;
+    VDPPlane plane;
+    const TileMap* tilemap;
+    u16 index;          // basetile
+    u16 x;
+    u16 y;
+    u16 xm;
+    u16 ym;
+    u16 w;
+    u16 h;
+    u16 done;           // rows already queued
+} DmaRequest;
+
+DmaRequest dma_requests[MAX_DMA_REQUESTS];
+u16 dma_request_head = 0;
+u16 dma_request_count = 0;
+
+// one row of a repeated tile map, copied into the dma queue
+u16 dma_row[64];
+
+bool dma_music_delay = FALSE;
+
+// instrumentation, logged once a second while there is any dma
+u16 dma_frames;
+u32 dma_bytes;
+u16 dma_peak;
+u16 dma_missed;
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// budget
+/////////////////////////////////////////////////////////////////////////////////////
+
+u16 vblankDmaLimit()
+{
+    return IS_PALSYSTEM ? VBLANK_DMA_PAL : VBLANK_DMA_NTSC;
+}
+
+u16 dmaFrameLimit()
+{
+    u16 limit = vblankDmaLimit();
+    return dma_music_delay ? limit - limit / 4 : limit;
+}
+
+u16 dmaEntriesAvailable()
+{
+    u16 size = DMA_getQueueSize();
+    return size < DMA_QUEUE_ENTRIES ? DMA_QUEUE_ENTRIES - size : 0;
+}
+
+u16 dmaBytesAvailable()
+{
+    u16 limit = dmaFrameLimit();
+    u16 queued = DMA_getQueueTransferSize();
+    if (dmaEntriesAvailable() == 0) return 0;
+    return queued < limit ? limit - queued : 0;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// requests
+/////////////////////////////////////////////////////////////////////////////////////
+
+DmaRequest* addDmaRequest(enum DMA_REQUEST_TYPE type)
+{
+    // the schedule is sized for the largest scene, so this is a bug in the caller - the upload is dropped
+    // rather than running frames from in here (sprites, scrolling and link would all miss them)
+    if (dma_request_count == MAX_DMA_REQUESTS)
+    {
+        KLog("dma schedule full");
+        return NULL;
+    }
+
+    DmaRequest* request = &dma_requests[(dma_request_head + dma_request_count) % MAX_DMA_REQUESTS];
+    dma_request_count++;
+    request->type = type;
+    request->done = 0;
+    return request;
+}
+
+bool scheduleTileMap(VDPPlane plane, const TileMap* tilemap, u16 basetile, u16 x, u16 y, u16 xm, u16 ym, u16 w, u16 h)
+{
+    DmaRequest* request = addDmaRequest(DMA_REQUEST_TILEMAP);
+    if (request == NULL) return FALSE;
+    request->plane = plane;
+    request->tilemap = tilemap;
+    request->index = basetile;
+    request->x = x;
+    request->y = y;
+    request->xm = xm;
+    request->ym = ym;
+    request->w = w;
+    request->h = h;
+    return TRUE;
+}
+
+bool scheduleTileMapRepeat(VDPPlane plane, const TileMap* tilemap, u16 basetile, u16 x, u16 y, u16 w, u16 h)
+{
+    DmaRequest* request = addDmaRequest(DMA_REQUEST_TILEMAP_REPEAT);
+    if (request == NULL) return FALSE;
+    request->plane = plane;
+    request->tilemap = tilemap;
+    request->index = basetile;
+    request->x = x;
+    request->y = y;
+    request->w = w;
+    request->h = h;
+    return TRUE;
+}
+
+bool isDmaScheduled()
+{
+    return dma_request_count > 0;
+}
+
+u16 scheduledDmaRequests()
+{
+    return dma_request_count;
+}
+
+// move as much of a request as fits to the dma queue, TRUE once all of it is queued
+bool queueDmaChunk(DmaRequest* request)
+{
+    u16 available = dmaBytesAvailable();
+
+    // tile maps go a row at a time (one queue entry each)
+    u16 row_bytes = request->w * 2;
+    u16 rows = request->h - request->done;
+    if (rows > available / row_bytes) rows = available / row_bytes;
+    if (rows > dmaEntriesAvailable()) rows = dmaEntriesAvailable();
+    if (rows == 0) return FALSE;
+
+    if (request->type == DMA_REQUEST_TILEMAP)
+    {
+        VDP_setTileMapEx(request->plane, request->tilemap, request->index, request->x, request->y + request->done, request->xm, request->ym + request->done, request->w, rows, DMA_QUEUE);
+        request->done += rows;
+        return request->done == request->h;
+    }
+
+    // repeated tile map - build each row in ram, the queue keeps its own copy
+    const TileMap* tilemap = request->tilemap;
+    u16 base = request->index & TILE_INDEX_MASK;
+    u16 attr = request->index & TILE_ATTR_MASK;
+    for(u16 r=0; r<rows; r++)
+    {
+        const u16* src = &tilemap->tilemap[(request->done % tilemap->h) * tilemap->w];
+        for(u16 i=0; i<request->w; i++) dma_row[i] = (src[i % tilemap->w] + base) | attr;
+        VDP_setTileMapDataRect(request->plane, dma_row, request->x, request->y + request->done, request->w, 1, request->w, DMA_QUEUE_COPY);
+        request->done++;
+    }
+    return request->done == request->h;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// frame
+/////////////////////////////////////////////////////////////////////////////////////
+
+void updateDmaScheduler()
+{
+    // while the XGM driver runs, SGDK holds DMA until the driver is done with the bus for the frame. Only
+    // asked when XGM is the loaded driver - XGM_isPlaying() would load it (music off)
+    bool music = (Z80_getLoadedDriver() == Z80_DRIVER_XGM) && XGM_isPlaying();
+    if (music != dma_music_delay)
+    {
+        XGM_setForceDelayDMA(music);
+        dma_music_delay = music;
+    }
+
+    // in order - a request only starts once the one before it is fully queued
+    while (dma_request_count > 0)
+    {
+        if (!queueDmaChunk(&dma_requests[dma_request_head])) break;
+        dma_request_head = (dma_request_head + 1) % MAX_DMA_REQUESTS;
+        dma_request_count--;
+    }
+}
+
+void endDmaFrame()
+{
+    // everything queued is about to be flushed - more than vblank can take runs on into the display
+    u16 queued = DMA_getQueueTransferSize();
+    if (queued > vblankDmaLimit()) dma_missed++;
+    if (queued > dma_peak) dma_peak = queued;
+    dma_bytes += queued;
+
+    if (++dma_frames < (IS_PALSYSTEM ? 50 : 60)) return;
+    if (dma_bytes > 0) KLog_U3("dma bytes/s ", dma_bytes, " peak frame ", dma_peak, " missed vblanks ", dma_missed);
+    dma_frames = 0;
+    dma_bytes = 0;
+    dma_peak = 0;
+    dma_missed = 0;
+}
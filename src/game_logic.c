@@ -0,0 +1,504 @@
+/**
+ * Tic-Tac-Toe
+ * Game logic shared by the ROM and the host tools
+ **/
+#include <genesis.h>
+#include <game_logic.h>
+#include <policy_tables.h>
+
+const u8 winning_lines[8][3] = {{0, 1, 2}, {3, 4, 5}, {6, 7, 8}, {0, 3, 6}, {1, 4, 7}, {2, 5, 8}, {0, 4, 8}, {2, 4, 6}};
+
+// the 8 rotations/reflections of the board - square i of the transformed board is board[board_symmetries[t][i]]
+const u8 board_symmetries[8][9] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8}, {6, 3, 0, 7, 4, 1, 8, 5, 2}, {8, 7, 6, 5, 4, 3, 2, 1, 0}, {2, 5, 8, 1, 4, 7, 0, 3, 6},
+    {2, 1, 0, 5, 4, 3, 8, 7, 6}, {6, 7, 8, 3, 4, 5, 0, 1, 2}, {0, 3, 6, 1, 4, 7, 2, 5, 8}, {8, 5, 2, 7, 4, 1, 6, 3, 0}};
+
+// lines through each square, as bits of winning_lines
+const u8 square_lines[9] = {0x49, 0x11, 0xA1, 0x0A, 0xD2, 0x22, 0x8C, 0x14, 0x64};
+
+// the search tries the center, then the corners, then the sides
+const u8 search_order[9] = {CENTER_MIDDLE, TOP_LEFT, TOP_RIGHT, BOTTOM_LEFT, BOTTOM_RIGHT, TOP_MIDDLE, CENTER_LEFT, CENTER_RIGHT, BOTTOM_MIDDLE};
+
+// search limits of each OPPONENT_TYPE (PLAYER_2 is never searched), see tools/search_bench.c for what they cost and how they play
+const SearchLimits default_difficulty_limits[4] = {
+    {0, 0, 0},
+    {9, 1, 180},
+    {16, 2, 5},
+    {40, 9, 0},
+};
+
+// current state
+enum OPPONENT_TYPE game_opponent = CPU_EASY;
+enum RULE_VARIANT game_rules = RULES_STANDARD;
+SearchLimits difficulty_limits[4];
+
+#ifdef LOGIC_COST_MODEL
+u32 logic_cycles;
+#endif
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// general
+/////////////////////////////////////////////////////////////////////////////////////
+
+int randomRange(int min, int max)
+{
+    LOGIC_COST(310);    // call, random() ~150, divu for the modulo ~140
+    return (random() % (max - min + 1)) + min;
+}
+
+bool randTest(int percentage)
+{
+    return randomRange(0, 100) < percentage;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// game logic
+/////////////////////////////////////////////////////////////////////////////////////
+
+int countTilesOnWinLine(GameBoard* board, int line_index, enum SQUARE_STATE state)
+{
+    int res = 0;
+    LOGIC_COST(74);     // call with 3 args, line_index * 3 address calculation
+    for (int i=0; i<3; i++)
+    {
+        LOGIC_COST(46); // moveq / move.b (a0)+ / cmp.b (a1,d0.w) / bne / addq / dbra
+        if (board->squares[winning_lines[line_index][i]] == state) res++;
+    }
+    return res;
+}
+
+int randomMove(GameBoard* board)
+{
+    int r = randomRange(0, board->moves_remaining-1);
+    LOGIC_COST(60);
+    for (int i=0; i<9; i++)
+    {
+        LOGIC_COST(34);
+        if (board->squares[i] == EMPTY)
+        {
+            if (r == 0) return i;
+            r--;
+        }
+    }
+
+    // we should never get here
+    return 0;
+}
+
+u16 canonicalPosition(const u8* board, enum SQUARE_STATE player, int* symmetry)
+{
+    u16 best = 0xFFFF;
+    LOGIC_COST(60);
+
+    // base 3 code (0 empty, 1 player, 2 opponent) of every symmetry, keeping the smallest
+    for (int t=0; t<8; t++)
+    {
+        u16 code = 0;
+        LOGIC_COST(30);
+        for (int i=0; i<9; i++)
+        {
+            LOGIC_COST(80); // byte index load, byte board read, 2 compares, code * 3 as add/shift, add
+            enum SQUARE_STATE state = board[board_symmetries[t][i]];
+            code = code * 3 + (state == EMPTY ? 0 : state == player ? 1 : 2);
+        }
+
+        if (code < best)
+        {
+            best = code;
+            *symmetry = t;
+        }
+    }
+
+    return best;
+}
+
+int findPosition(u16 code)
+{
+    // binary search of the (sorted) policy table, -1 if the position is not there
+    int lo = 0;
+    int hi = POLICY_POSITIONS - 1;
+    LOGIC_COST(80);
+    while (lo < hi)
+    {
+        LOGIC_COST(60);
+        int mid = (lo + hi) / 2;
+        if (policy_positions[mid] < code) lo = mid + 1;
+        else hi = mid;
+    }
+    return policy_positions[lo] == code ? lo : -1;
+}
+
+bool takeWin(GameBoard* board, int* squareIndex, enum SQUARE_STATE player)
+{
+    LOGIC_COST(60);
+    for (int line_index=0; line_index<8; line_index++)
+    {
+        LOGIC_COST(30);
+        if ((countTilesOnWinLine(board, line_index, player) == 2) && (countTilesOnWinLine(board, line_index, EMPTY) == 1))
+        {
+            for (int i=0; i<3; i++)
+            {
+                LOGIC_COST(40);
+                if (board->squares[winning_lines[line_index][i]] == EMPTY)
+                {
+                    *squareIndex = winning_lines[line_index][i];
+                    return TRUE;
+                }
+            }
+        }
+    }
+
+    return FALSE;
+}
+
+bool stopLoss(GameBoard* board, int* squareIndex, enum SQUARE_STATE player)
+{
+    // same logic as takeWin, but from the point of view of the other player
+    LOGIC_COST(40);
+    return takeWin(board, squareIndex, player == NOUGHT ? CROSS : NOUGHT);
+}
+
+bool bestSquare(const u8* values, int* squareIndex)
+{
+    // return the square with the largest value
+    *squareIndex = 0;
+    LOGIC_COST(40);
+    for(int i=1; i<9; i++)
+    {
+        LOGIC_COST(36);
+        if (values[i] > values[*squareIndex])
+        {
+            *squareIndex = i;
+        }
+    }
+
+    // return TRUE if the maximum square had at least 1 line
+    return (values[*squareIndex] > 0);
+}
+
+bool addToWinnableLine(GameBoard* board, int* squareIndex, enum SQUARE_STATE player)
+{
+    u8 values[9] = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    LOGIC_COST(100);    // call, clearing values
+
+    // calculate the number of winnable lines for each square
+    for (int line_index=0; line_index<8; line_index++)
+    {
+        LOGIC_COST(30);
+        if ((countTilesOnWinLine(board, line_index, player) == 1) && (countTilesOnWinLine(board, line_index, EMPTY) == 2))
+        {
+            for (int i=0; i<3; i++)
+            {
+                LOGIC_COST(56);
+                if (board->squares[winning_lines[line_index][i]] == EMPTY) values[winning_lines[line_index][i]]++;
+            }
+        }
+    }
+
+    return bestSquare(values, squareIndex);
+}
+
+bool blockLoseableLine(GameBoard* board, int* squareIndex, enum SQUARE_STATE player)
+{
+    // same logic as addToWinnableLine, but from the point of view of the other player
+    LOGIC_COST(40);
+    return addToWinnableLine(board, squareIndex, player == NOUGHT ? CROSS : NOUGHT);
+}
+
+int cpuTurn(GameBoard* board)
+{
+    u8 piece;
+    return cpuMove(board, &piece);
+}
+
+int cpuMove(GameBoard* board, u8* piece)
+{
+    SearchContext context;
+    LOGIC_COST(60);
+
+    // two players - should not get here
+    if (game_opponent == PLAYER_2)
+    {
+        *piece = nextPiece(board, 0);
+        return randomMove(board);
+    }
+
+    context.limits = difficulty_limits[game_opponent];
+    int square = searchMove(&context, board);
+    *piece = context.piece;
+    return square;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// search
+/////////////////////////////////////////////////////////////////////////////////////
+
+void resetDifficultyLimits()
+{
+    for (int i=0; i<4; i++) difficulty_limits[i] = default_difficulty_limits[i];
+}
+
+int searchMove(SearchContext* context, GameBoard* board)
+{
+    return rule_variants[game_rules].searchMove(context, board);
+}
+
+u32 searchCycles(u16 nodes)
+{
+    // the most a search under game_rules that visits this many nodes costs
+    const RuleVariant* variant = &rule_variants[game_rules];
+    return variant->search_cycles + (u32)variant->node_cycles * nodes;
+}
+
+u32 searchWorstCase(const SearchLimits* limits)
+{
+    // at most max_nodes nodes, or one per empty square if that is more (searchMove in rule_variant.h)
+    if (limits->max_depth == 0) return searchCycles(0);
+    return searchCycles(limits->max_nodes > 9 ? limits->max_nodes : 9);
+}
+
+s8 moveValue(GameBoard* board, int square)
+{
+    GameBoard next = *board;
+    int symmetry;
+    LOGIC_COST(140);    // board copy
+
+    // value of playing square for the side to move, from the table of the reply position
+    if (placePiece(&next, square)) return next.moves_remaining + 1;
+    if (next.moves_remaining == 0) return 0;
+    nextPlayer(&next);
+
+    int index = findPosition(canonicalPosition(next.squares, next.current_player, &symmetry));
+    LOGIC_COST(30);
+    if (index < 0) return POSITION_UNKNOWN;
+    return -position_values[index];
+}
+
+void clearBoard(GameBoard* board)
+{
+    for (int i=0; i<9; i++) board->squares[i] = EMPTY;
+    board->moves_remaining = 9;
+}
+
+bool placePiece(GameBoard* board, int square)
+{
+    return placeMove(board, square, board->current_player);
+}
+
+bool placeMove(GameBoard* board, int square, u8 piece)
+{
+    board->squares[square] = piece;
+    board->moves_history[9-board->moves_remaining] = square;
+    board->moves_remaining--;
+    return testWin(board);
+}
+
+void nextPlayer(GameBoard* board)
+{
+    board->current_player = board->current_player == CROSS ? NOUGHT : CROSS;
+}
+
+bool testWin(GameBoard* board)
+{
+    // TRUE if the last move made a line - whether that won is lineWinner's call
+    return rule_variants[game_rules].testWin(board);
+}
+
+enum SQUARE_STATE lineWinner(GameBoard* board)
+{
+    // for a line made by current_player (before nextPlayer)
+    if (rule_variants[game_rules].line_loses) return board->current_player == CROSS ? NOUGHT : CROSS;
+    return board->current_player;
+}
+
+u8 nextPiece(GameBoard* board, u8 piece)
+{
+    // the piece after piece (or the first for 0) the side to move can put down, 0 after the last
+    return rule_variants[game_rules].nextPiece(board, piece);
+}
+
+u16 boardNumbers(const u8* squares)
+{
+    u16 numbers = 0;
+    for (int i=0; i<9; i++) numbers |= 1 << squares[i];
+    return numbers & ~1;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// rule variants
+/////////////////////////////////////////////////////////////////////////////////////
+
+// static evaluation of each variant at the depth limit, for the side to move
+
+s16 evaluateStandard(SearchContext* context, enum SQUARE_STATE player, int empties)
+{
+    s16 score = 0;
+    u8 threats = 0;
+    u8 opponent_threats = 0;
+    LOGIC_COST(70);
+
+    for (int l=0; l<8; l++)
+    {
+        LOGIC_COST(110);    // 3 byte reads through the line table, 2 compares each, counting
+        int own = 0;
+        int other = 0;
+        for (int i=0; i<3; i++)
+        {
+            u8 state = context->squares[winning_lines[l][i]];
+            if (state == player) own++;
+            else if (state != EMPTY) other++;
+        }
+
+        // open lines count by the square of their pieces, two in an open line threatens a win
+        if (other == 0)
+        {
+            score += own * own;
+            if (own == 2) threats++;
+        }
+        if (own == 0)
+        {
+            score -= other * other;
+            if (other == 2) opponent_threats++;
+        }
+    }
+
+    // the side to move completes a threat, and cannot stop two of them
+    if (threats > 0) return SEARCH_WIN + empties - 1;
+    if (opponent_threats > 1) return -(SEARCH_WIN + empties - 2);
+    return score;
+}
+
+s16 evaluateMisere(SearchContext* context, enum SQUARE_STATE player, int empties)
+{
+    (void)empties;
+    s16 score = 0;
+    LOGIC_COST(70);
+
+    // the standard line count turned round - pieces in open lines are a liability
+    for (int l=0; l<8; l++)
+    {
+        LOGIC_COST(100);
+        int own = 0;
+        int other = 0;
+        for (int i=0; i<3; i++)
+        {
+            u8 state = context->squares[winning_lines[l][i]];
+            if (state == player) own++;
+            else if (state != EMPTY) other++;
+        }
+        if (other == 0) score -= own * own;
+        if (own == 0) score += other * other;
+    }
+    return score;
+}
+
+s16 evaluateWild(SearchContext* context, enum SQUARE_STATE player, int empties)
+{
+    (void)player;
+    LOGIC_COST(70);
+
+    // two of a mark and a gap is a line for whoever moves next - nothing else favours either side
+    for (int l=0; l<8; l++)
+    {
+        LOGIC_COST(100);
+        u8 a = context->squares[winning_lines[l][0]];
+        u8 b = context->squares[winning_lines[l][1]];
+        u8 c = context->squares[winning_lines[l][2]];
+        if ((a == EMPTY) + (b == EMPTY) + (c == EMPTY) != 1) continue;
+        if ((a | b | c) != CROSS && (a | b | c) != NOUGHT) continue;
+        return SEARCH_WIN + empties - 1;
+    }
+    return 0;
+}
+
+u8 nextNumber(u16 numbers, s8 number)
+{
+    // the next number of the same parity not on the board yet, 0 after 9
+    for (number += 2; number <= 9; number += 2)
+    {
+        if (!(numbers & (1 << number))) return number;
+    }
+    return 0;
+}
+
+s16 evaluateNumerical(SearchContext* context, enum SQUARE_STATE player, int empties)
+{
+    (void)player;
+    // the first player has the odd numbers, so the side to move does when an odd number of squares is left
+    u8 odd = empties & 1;
+    LOGIC_COST(70);
+
+    // a line of two numbers missing one the side to move still has
+    for (int l=0; l<8; l++)
+    {
+        LOGIC_COST(130);
+        u8 a = context->squares[winning_lines[l][0]];
+        u8 b = context->squares[winning_lines[l][1]];
+        u8 c = context->squares[winning_lines[l][2]];
+        if ((a == EMPTY) + (b == EMPTY) + (c == EMPTY) != 1) continue;
+        s8 missing = 15 - a - b - c;
+        if ((missing < 1) || (missing > 9) || ((missing & 1) != odd) || (context->numbers & (1 << missing))) continue;
+        return SEARCH_WIN + empties - 1;
+    }
+    return 0;
+}
+
+#define RULES_NAME Standard
+#define RULES_LINE(a, b, c) (((a) == (b)) && ((b) == (c)))
+#define RULES_LINE_COST 60
+#define RULES_LINE_LOSES 0
+#define RULES_MIN_MOVES 5
+#define RULES_MAX_PIECES 1
+#define RULES_FIRST_PIECE(player, numbers, empties) (player)
+#define RULES_NEXT_PIECE(piece, numbers) 0
+#define RULES_PIECE_COST 0
+#define RULES_NUMBERS 0
+#include <rule_variant.h>
+
+#define RULES_NAME Misere
+#define RULES_LINE(a, b, c) (((a) == (b)) && ((b) == (c)))
+#define RULES_LINE_COST 60
+#define RULES_LINE_LOSES 1
+#define RULES_MIN_MOVES 5
+#define RULES_MAX_PIECES 1
+#define RULES_FIRST_PIECE(player, numbers, empties) (player)
+#define RULES_NEXT_PIECE(piece, numbers) 0
+#define RULES_PIECE_COST 0
+#define RULES_NUMBERS 0
+#include <rule_variant.h>
+
+#define RULES_NAME Wild
+#define RULES_LINE(a, b, c) (((a) == (b)) && ((b) == (c)))
+#define RULES_LINE_COST 60
+#define RULES_LINE_LOSES 0
+#define RULES_MIN_MOVES 3
+#define RULES_MAX_PIECES 2
+#define RULES_FIRST_PIECE(player, numbers, empties) CROSS
+#define RULES_NEXT_PIECE(piece, numbers) ((piece) == CROSS ? NOUGHT : 0)
+#define RULES_PIECE_COST 20
+#define RULES_NUMBERS 0
+#include <rule_variant.h>
+
+#define RULES_NAME Numerical
+#define RULES_LINE(a, b, c) ((a) && (b) && (c) && ((a) + (b) + (c) == 15))
+#define RULES_LINE_COST 80
+#define RULES_LINE_LOSES 0
+#define RULES_MIN_MOVES 3
+#define RULES_MAX_PIECES 5
+#define RULES_FIRST_PIECE(player, numbers, empties) nextNumber(numbers, (empties) & 1 ? -1 : 0)
+#define RULES_NEXT_PIECE(piece, numbers) nextNumber(numbers, piece)
+#define RULES_PIECE_COST 40
+#define RULES_NUMBERS 1
+#include <rule_variant.h>
+
+// indexed by RULE_VARIANT
+const RuleVariant rule_variants[4] = {
+    { FALSE, testWinStandard, searchMoveStandard, nextPieceStandard, 6000, 1500 },
+    { TRUE, testWinMisere, searchMoveMisere, nextPieceMisere, 5500, 1450 },
+    { FALSE, testWinWild, searchMoveWild, nextPieceWild, 11500, 1400 },
+    { FALSE, testWinNumerical, searchMoveNumerical, nextPieceNumerical, 4500, 2200 },
+};
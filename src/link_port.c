@@ -0,0 +1,144 @@
+/**
+ * Tic-Tac-Toe
+ * Serial link on controller port 2
+ *
+ * Port 2 is put in serial mode (TL out, TR in) at 4800 baud, about 480 bytes a
+ * second - link play sends one byte a frame. A received byte raises the external
+ * interrupt, which moves it to a ring the game reads at its own pace; the port is
+ * polled too, so nothing is lost with the interrupt masked. Bytes to send wait in
+ * a small ring until the transmit register is free.
+ **/
+#include <genesis.h>
+#include <link_port.h>
+
+#define PORT2_CTRL 0xA1000B
+#define PORT2_TX_DATA 0xA10015
+#define PORT2_RX_DATA 0xA10017
+#define PORT2_SCTRL 0xA10019
+
+// serial control bits (the two high bits are the baud rate, 00 for 4800)
+const u8 SCTRL_SIN = 0x20;
+const u8 SCTRL_SOUT = 0x10;
+const u8 SCTRL_RINT = 0x08;
+const u8 SCTRL_RERR = 0x04;
+const u8 SCTRL_RRDY = 0x02;
+const u8 SCTRL_TFUL = 0x01;
+
+// vdp register 11 bit 3 lets the port raise the external interrupt
+const u8 VDP_EXT_INT = 0x08;
+
+#define LINK_RX_SIZE 64
+#define LINK_TX_SIZE 8
+
+vu8 link_rx[LINK_RX_SIZE];
+vu16 link_rx_head = 0;
+vu16 link_rx_tail = 0;
+u8 link_tx[LINK_TX_SIZE];
+u16 link_tx_head = 0;
+u16 link_tx_count = 0;
+
+u16 link_rx_errors;
+u16 link_rx_overruns;
+
+void receiveLinkByte()
+{
+    vu8* sctrl = (vu8*)PORT2_SCTRL;
+
+    // (the interrupt and the poll share this, hence the loop on the status)
+    while (*sctrl & (SCTRL_RRDY | SCTRL_RERR))
+    {
+        u8 status = *sctrl;
+        u8 byte = *(vu8*)PORT2_RX_DATA;
+
+        // a framing error leaves a byte that is not the peer's
+        if (status & SCTRL_RERR)
+        {
+            link_rx_errors++;
+            continue;
+        }
+
+        u16 next = (link_rx_head + 1) % LINK_RX_SIZE;
+        if (next == link_rx_tail)
+        {
+            link_rx_overruns++;
+            continue;
+        }
+        link_rx[link_rx_head] = byte;
+        link_rx_head = next;
+    }
+}
+
+void flushLinkTx()
+{
+    while ((link_tx_count > 0) && !(*(vu8*)PORT2_SCTRL & SCTRL_TFUL))
+    {
+        *(vu8*)PORT2_TX_DATA = link_tx[link_tx_head];
+        link_tx_head = (link_tx_head + 1) % LINK_TX_SIZE;
+        link_tx_count--;
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// port
+/////////////////////////////////////////////////////////////////////////////////////
+
+void startLinkPort()
+{
+    // the pad code leaves the port alone from here on
+    JOY_setSupport(PORT_2, JOY_SUPPORT_OFF);
+
+    SYS_disableInts();
+    link_rx_head = 0;
+    link_rx_tail = 0;
+    link_tx_head = 0;
+    link_tx_count = 0;
+    link_rx_errors = 0;
+    link_rx_overruns = 0;
+
+    *(vu8*)PORT2_CTRL = 0x00;
+    *(vu8*)PORT2_SCTRL = SCTRL_SIN | SCTRL_SOUT | SCTRL_RINT;
+    // drop anything left in the receive register
+    (void)*(vu8*)PORT2_RX_DATA;
+
+    SYS_setExtIntCallback(receiveLinkByte);
+    VDP_setReg(11, VDP_getReg(11) | VDP_EXT_INT);
+    SYS_enableInts();
+}
+
+void stopLinkPort()
+{
+    SYS_disableInts();
+    VDP_setReg(11, VDP_getReg(11) & ~VDP_EXT_INT);
+    SYS_setExtIntCallback(NULL);
+    *(vu8*)PORT2_SCTRL = 0x00;
+    SYS_enableInts();
+
+    if (link_rx_errors || link_rx_overruns) KLog_U2("link rx errors ", link_rx_errors, " overruns ", link_rx_overruns);
+
+    // back to a pad, whatever is plugged in is detected again
+    JOY_reset();
+}
+
+bool linkPortRead(u8* byte)
+{
+    // whatever came in with the interrupt masked (not while the interrupt could add to the ring)
+    SYS_disableInts();
+    receiveLinkByte();
+    SYS_enableInts();
+    flushLinkTx();
+
+    if (link_rx_tail == link_rx_head) return FALSE;
+    *byte = link_rx[link_rx_tail];
+    link_rx_tail = (link_rx_tail + 1) % LINK_RX_SIZE;
+    return TRUE;
+}
+
+bool linkPortWrite(u8 byte)
+{
+    if (link_tx_count == LINK_TX_SIZE) return FALSE;
+    link_tx[(link_tx_head + link_tx_count) % LINK_TX_SIZE] = byte;
+    link_tx_count++;
+    flushLinkTx();
+    return TRUE;
+}
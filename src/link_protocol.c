@@ -0,0 +1,221 @@
+/**
+ * Tic-Tac-Toe
+ * Lockstep protocol of link play
+ *
+ * Each console sends one byte a frame. Until both are talking they send hellos
+ * (bit 7 clear): a random 6 bit nonce, with bit 6 set once the peer's nonce is
+ * in; the larger nonce plays CROSS. After that every byte is the pad of one
+ * lockstep frame (bit 7 set, bits 0-5 LINK_* buttons) and bit 6 is a token the
+ * two consoles hand back and forth - CROSS returns it as it came, NOUGHT flips it -
+ * so the time between two flips is the round trip.
+ *
+ * The pad read on frame n is used on lockstep frame n + input_delay, and a frame
+ * is only run once both pads for it are in, so both consoles see the same presses
+ * in the same order. The board is only changed by those frames (linkAction); the
+ * local cursor is drawn ahead of them, as only the player to move can change it -
+ * replayed each frame from the lockstep's square over the inputs still in flight,
+ * so presses made on the other player's turn land once the turn comes round.
+ **/
+#include <genesis.h>
+#include <game_logic.h>
+#include <link_protocol.h>
+
+const u8 LINK_INPUT_BYTE = 0x80;
+const u8 LINK_TOKEN = 0x40;
+const u8 LINK_HELLO_SEEN = 0x40;
+
+
+void startLink(LinkSession* link, u8 input_delay)
+{
+    link->state = LINK_HELLO;
+    link->nonce = (random() % 63) + 1;
+    link->remote_nonce = 0;
+    link->cross = FALSE;
+    link->input_delay = input_delay < LINK_WINDOW ? input_delay : LINK_WINDOW - 1;
+
+    link->frame = 0;
+    link->send_frame = 0;
+    link->remote_count = 0;
+    link->sim_frame = 0;
+    link->last_inputs[0] = 0;
+    link->last_inputs[1] = 0;
+
+    link->token_in = 0;
+    link->token_frame = 0;
+    link->rtt = 0;
+    link->rtt_max = 0;
+
+    link->silent_frames = 0;
+    link->stall_frames = 0;
+    link->last_sim_frame = 0;
+    link->bytes_sent = 0;
+    link->bytes_received = 0;
+}
+
+void startLockstep(LinkSession* link)
+{
+    link->state = LINK_PLAYING;
+    link->cross = link->nonce > link->remote_nonce;
+    link->token_frame = link->frame;
+}
+
+s16 linkSend(LinkSession* link, u8 buttons)
+{
+    link->frame++;
+    if (link->state == LINK_LOST) return -1;
+
+    if (++link->silent_frames > LINK_TIMEOUT_FRAMES)
+    {
+        link->state = LINK_LOST;
+        return -1;
+    }
+
+    if (link->state == LINK_HELLO)
+    {
+        link->bytes_sent++;
+        return link->nonce | (link->remote_nonce ? LINK_HELLO_SEEN : 0);
+    }
+
+    // no progress since the last frame - waiting on the peer
+    if (link->sim_frame == link->last_sim_frame) link->stall_frames++;
+    link->last_sim_frame = link->sim_frame;
+
+    // not more than a window ahead of the lockstep, the peer keeps no more than that
+    if (link->send_frame + link->input_delay >= link->sim_frame + LINK_WINDOW) return -1;
+
+    link->local_inputs[(link->send_frame + link->input_delay) % LINK_BUFFER] = buttons & 0x3F;
+    link->send_frame++;
+    link->bytes_sent++;
+    // CROSS hands the token straight back, NOUGHT flips it - so one flip goes round
+    u8 token = link->cross ? link->token_in : !link->token_in;
+    return LINK_INPUT_BYTE | (token ? LINK_TOKEN : 0) | (buttons & 0x3F);
+}
+
+void linkReceive(LinkSession* link, u8 byte)
+{
+    link->bytes_received++;
+    link->silent_frames = 0;
+
+    if (!(byte & LINK_INPUT_BYTE))
+    {
+        // hellos still in the pipe once playing are stale
+        if (link->state != LINK_HELLO) return;
+
+        u8 nonce = byte & 0x3F;
+        if (nonce == link->nonce)
+        {
+            // same nonce on both sides - both pick again
+            link->nonce = (random() % 63) + 1;
+            link->remote_nonce = 0;
+            return;
+        }
+        link->remote_nonce = nonce;
+        if (byte & LINK_HELLO_SEEN) startLockstep(link);
+        return;
+    }
+
+    if (link->state == LINK_HELLO)
+    {
+        // the peer only plays once it has our nonce, so its first input byte also means go
+        if (!link->remote_nonce) return;
+        startLockstep(link);
+    }
+    if (link->state != LINK_PLAYING) return;
+
+    link->remote_inputs[(link->remote_count + link->input_delay) % LINK_BUFFER] = byte & 0x3F;
+    link->remote_count++;
+
+    u8 token = (byte & LINK_TOKEN) ? 1 : 0;
+    if (token != link->token_in)
+    {
+        // (the first flip only marks the start)
+        link->token_in = token;
+        if (link->remote_count > 1)
+        {
+            link->rtt = link->frame - link->token_frame;
+            if (link->rtt > link->rtt_max) link->rtt_max = link->rtt;
+        }
+        link->token_frame = link->frame;
+    }
+}
+
+bool linkStep(LinkSession* link, u8* pressed)
+{
+    u8 local = 0;
+    u8 remote = 0;
+
+    if (link->state != LINK_PLAYING) return FALSE;
+
+    // the first input_delay frames have nobody pressing anything
+    if (link->sim_frame >= link->input_delay)
+    {
+        if (link->send_frame + link->input_delay <= link->sim_frame) return FALSE;
+        if (link->remote_count + link->input_delay <= link->sim_frame) return FALSE;
+        local = link->local_inputs[link->sim_frame % LINK_BUFFER];
+        remote = link->remote_inputs[link->sim_frame % LINK_BUFFER];
+    }
+    link->sim_frame++;
+
+    u8 cross = link->cross ? local : remote;
+    u8 nought = link->cross ? remote : local;
+    pressed[0] = cross & ~link->last_inputs[0];
+    pressed[1] = nought & ~link->last_inputs[1];
+    link->last_inputs[0] = cross;
+    link->last_inputs[1] = nought;
+    return TRUE;
+}
+
+bool isLocalTurn(LinkSession* link, GameBoard* board)
+{
+    return link->cross == (board->current_player == CROSS);
+}
+
+u8 linkPredictCursor(LinkSession* link, GameBoard* board, u8 square)
+{
+    // the other player has the cursor until a take hands it over
+    if (!isLocalTurn(link, board)) return square;
+
+    u8 last = link->last_inputs[link->cross ? 0 : 1];
+    for (u16 frame = link->sim_frame; frame < link->send_frame + link->input_delay; frame++)
+    {
+        // (the first input_delay frames have nobody pressing anything)
+        u8 buttons = frame >= link->input_delay ? link->local_inputs[frame % LINK_BUFFER] : 0;
+        u8 pressed = buttons & ~last;
+        last = buttons;
+
+        // as linkAction - and a take hands the cursor to the other player
+        square = cursorMove(square, pressed);
+        if ((pressed & LINK_A) && (board->squares[square] == EMPTY)) break;
+    }
+    return square;
+}
+
+u8 cursorMove(u8 square, u8 pressed)
+{
+    // the same wrapping moves as the pad in a local game
+    if (pressed & LINK_RIGHT) square = (square / 3 * 3) + ((square + 1) % 3);
+    if (pressed & LINK_LEFT) square = (square / 3 * 3) + ((square + 2) % 3);
+    if (pressed & LINK_UP) square = (square + 6) % 9;
+    if (pressed & LINK_DOWN) square = (square + 3) % 9;
+    return square;
+}
+
+enum LINK_ACTION linkAction(GameBoard* board, bool game_over, const u8* pressed, u8* square)
+{
+    // between games either player starts the next one, or leaves
+    if (game_over)
+    {
+        if ((pressed[0] | pressed[1]) & LINK_C) return LINK_QUIT;
+        if ((pressed[0] | pressed[1]) & LINK_A) return LINK_NEXT_GAME;
+        return LINK_NONE;
+    }
+
+    // only the player to move has the cursor
+    u8 buttons = pressed[board->current_player == CROSS ? 0 : 1];
+    u8 moved = cursorMove(*square, buttons);
+    bool changed = moved != *square;
+    *square = moved;
+
+    if ((buttons & LINK_A) && (board->squares[moved] == EMPTY)) return LINK_TAKE;
+    return changed ? LINK_CURSOR : LINK_NONE;
+}
@@ -5,43 +5,86 @@
 #include <genesis.h>
 #include <string.h>
 #include <resources.h>
+#include <game_logic.h>
+#include <piece_anim.h>
+#include <dma_scheduler.h>
+#include <link_protocol.h>
+#include <link_port.h>
+#include <puzzles.h>
+#include <puzzle_tables.h>
+#include <benchmark.h>
 
-enum GAME_STATE { MAIN_MENU, CREDITS, SELECT_OPPONENT, SELECT_PLAYER2_INPUT, GAME_PLAYING, GAME_RESULT, PAUSE_MENU };
-enum SQUARE_STATE { EMPTY, NOUGHT, CROSS };
-enum OPPONENT_TYPE { PLAYER_2, CPU_EASY, CPU_MEDIUM, CPU_HARD };
+enum GAME_STATE { MAIN_MENU, CREDITS, SELECT_OPPONENT, SELECT_PLAYER2_INPUT, GAME_PLAYING, GAME_RESULT, PAUSE_MENU, SIMUL_PLAYING, SIMUL_RESULT, PUZZLE_PLAYING, PUZZLE_RESULT, BENCHMARK, BENCHMARK_RESULT };
 
-const int MAIN_MENU_1_PLAY = 0;
-const int MAIN_MENU_2_PLAY = 1;
-const int MAIN_MENU_CREDITS = 2;
+enum MAIN_MENU_OPTION { MAIN_MENU_1_PLAY, MAIN_MENU_2_PLAY, MAIN_MENU_SIMUL, MAIN_MENU_PUZZLES, MAIN_MENU_CREDITS, MAIN_MENU_MUSIC, MAIN_MENU_RULES };
 
-const int TOP_LEFT = 0;
-const int TOP_MIDDLE = 1;
-const int TOP_RIGHT = 2;
-const int CENTER_LEFT = 3;
-const int CENTER_MIDDLE = 4;
-const int CENTER_RIGHT = 5;
-const int BOTTOM_LEFT = 6;
-const int BOTTOM_MIDDLE = 7;
-const int BOTTOM_RIGHT = 8;
-
-const int winning_lines[8][3] = {{0, 1, 2}, {3, 4, 5}, {6, 7, 8}, {0, 3, 6}, {1, 4, 7}, {2, 5, 8}, {0, 4, 8}, {2, 4, 6}};
+enum LIMIT_FIELD { LIMIT_NONE, LIMIT_NODES, LIMIT_DEPTH, LIMIT_NOISE };
 
 // current state
 enum GAME_STATE current_game_state = MAIN_MENU;
-int selected_menu_option;
-u8 moves_remaining;
+enum GAME_STATE paused_game_state;
+u8 selected_menu_option;
+u8 selected_limit_field;
 u8 selected_square;
-enum OPPONENT_TYPE game_opponent = CPU_EASY;
-enum SQUARE_STATE game_board[9];
-enum SQUARE_STATE current_player = CROSS;
 u16 player2_pad;
-int moves_history[9];
+GameBoard game_board = { { EMPTY }, CROSS };
+bool music_enabled = TRUE;
+enum RULE_VARIANT selected_rules = RULES_STANDARD;
+u8 selected_piece;
+u16 pending_numbers = 0;
 
 // player scores
 u32 games_played = 0;
 u32 games_won = 0;
 u32 games_lost = 0;
 
+// simul - up to 4 games against the cpu at once
+GameBoard simul_boards[4];
+bool simul_cpu_pending[4];
+u8 simul_board_count = 4;
+u8 simul_selected_board;
+u16 simul_won = 0;
+u16 simul_lost = 0;
+u16 simul_drawn = 0;
+u32 simul_frame_max[4];
+u8 simul_cpu_board;
+
+// link play - player 2 on another console, over a cable in port 2
+const u16 LINK_PAD = 0xFF;
+bool link_play = FALSE;
+LinkSession link_session;
+u8 predicted_square;
+u16 link_moves;
+
+// analysis overlay - the exact value of every empty square for the side to move
+bool analysis_enabled = FALSE;
+bool analysis_pending = FALSE;
+
+// puzzles - positions to win in N moves, played as CROSS against the line stored with them
+const u16 PUZZLE_SRAM = sizeof(u32) * 12;
+
+// scores are kept per rule variant - standard first (where they always were), the others after the puzzles
+const u16 VARIANT_SCORE_SRAM = sizeof(u32) * 12 + sizeof(u16) * 2;
+Puzzle current_puzzle;
+u16 puzzle_index;
+u16 puzzles_solved;
+u8 puzzle_symmetry;
+
+// benchmark - hidden, START with B and C held on the title screen; one timed call a frame
+BenchResult bench_results[BENCH_ROWS];
+u8 bench_row;
+u8 bench_position;
+u32 bench_overhead;
+u32 bench_start_frame;
+u32 bench_frames;
+// the positions are set up on the game board, which is put back afterwards
+GameBoard bench_saved_board;
+enum OPPONENT_TYPE bench_saved_opponent;
+enum RULE_VARIANT bench_saved_rules;
+
+// indexed by RULE_VARIANT
+const char* rule_names[4] = { "STANDARD ", "MISERE   ", "WILD     ", "NUMERICAL" };
+
 // gfx
 u16 square_basetile;
 u16 cross_basetile;
@@ -55,46 +98,72 @@ Sprite* user_cursor[4];
 Sprite* pause_sprite[2];
 
 // background scrolling
-int scroll_offset_x = 0;
-int scroll_offset_y = 0;
+s16 scroll_offset_x = 0;
+s16 scroll_offset_y = 0;
+
+// plane A double buffering - the next screen is composed off screen (bga_addr), shown by vdp register 2
+enum TRANSITION_STEP { TRANSITION_IDLE, TRANSITION_FADE_OUT, TRANSITION_CLEAR, TRANSITION_CLEAR_BG_B, TRANSITION_COMPOSE, TRANSITION_FLIP, TRANSITION_DONE };
+const int TRANSITION_FADE_FRAMES = 12;
+u16 plane_a_front;
+u16 plane_a_back;
+u16 game_palette[64];
+enum TRANSITION_STEP transition_step = TRANSITION_IDLE;
+enum GAME_STATE transition_scene;
+bool transition_fade;
+bool plane_flip_pending = FALSE;
+u16 transition_frames;
+u32 transition_stall_max;
 
 // system startup
 void loadTiles();
 void loadPallete();
 void loadSprites();
+void initPlaneBuffers();
 
 // general
-int randomRange(int min, int max);
-bool randTest(int percentage);
 void scrollBackground();
 void handleJoypadInput(u16 joy, u16 changed, u16 state);
 
+// screen transitions
+void startTransition(enum GAME_STATE scene, bool fade);
+void updateTransition();
+void composeScene(enum GAME_STATE scene);
+void flipPlaneA();
+
 // main menu handling
 void startMainMenu();
 void updateMainMenu();
-void clearMainMenu();
 void handleMenuInput(u16 joy, u16 changed, u16 state);
 
 // credits
 void startCredits();
-void clearCredits();
 void handleCreditsInput(u16 joy, u16 changed, u16 state);
 
 // select opponent
 void startSelectOpponentMenu();
 void updateSelectOpponentMenu();
-void clearSelectOpponentMenu();
+void drawDifficultyLimits();
+void changeDifficultyLimit(int direction);
 void handleSelectOpponentInput(u16 joy, u16 changed, u16 state);
 
 // select player 2 input
 void StartSelectPlayer2Menu();
 void UpdateSelectPlayer2Menu();
-void clearSelectPlayer2Menu();
 void handleSelectPlayer2Input(u16 joy, u16 changed, u16 state);
 
+// link play
+void startLinkPlay();
+void stopLinkPlay();
+void updateLink();
+u8 linkButtons(u16 state);
+void applyLinkAction(enum LINK_ACTION action);
+
 // save state
+u16 scoreSram(enum OPPONENT_TYPE opponent);
 void loadScores(enum OPPONENT_TYPE opponent);
 void saveScores(enum OPPONENT_TYPE opponent);
+void loadPuzzleProgress();
+void savePuzzleProgress(u16 index);
 
 // game handling
 void startGame(enum OPPONENT_TYPE opponent);
@@ -103,12 +172,53 @@ void setBackground();
 void setForeground();
 void setUserCursorVisibility(SpriteVisibility value);
 void drawGameScores();
-void drawGameBoardSquare(int square, enum SQUARE_STATE state);
-void takeSquare(int squareindex);
+void drawGameBoardSquare(int square, u8 piece);
+void updateNumbers();
+void drawSelectedPiece();
+void takeSquare(int squareindex, u8 piece);
+void takeCpuTurn();
 void resetGame();
 void setSelectedSquare(int idx);
+void drawCursor(int idx);
 void handleGameInput(u16 joy, u16 changed, u16 state);
 
+// analysis overlay
+void startAnalysis();
+void updateAnalysis();
+void drawAnalysis();
+void clearAnalysis();
+
+// simul
+void startSimul(enum OPPONENT_TYPE opponent);
+void resetSimul();
+void drawSimulBoards();
+void drawSimulSquare(int board, int square, enum SQUARE_STATE state);
+void drawSimulScores();
+void setSimulSelection(int board, int square);
+void takeSimulSquare(int board, int squareindex);
+void finishSimulBoard(int board, enum SQUARE_STATE winner);
+void updateSimul();
+void handleSimulInput(u16 joy, u16 changed, u16 state);
+void handleSimulResultInput(u16 joy, u16 changed, u16 state);
+
+// puzzles
+void startPuzzles();
+void loadPuzzle();
+void drawPuzzleInfo(const char* status);
+void nextPuzzle(u16 index);
+void takePuzzleSquare(int squareindex);
+void handlePuzzleInput(u16 joy, u16 changed, u16 state);
+void handlePuzzleResultInput(u16 joy, u16 changed, u16 state);
+
+// benchmark
+void startBenchmark();
+void updateBenchmark();
+u32 timeBenchRow(int row);
+void finishBenchmark();
+void saveBenchmark();
+void showBenchmarkResult();
+void handleBenchmarkResultInput(u16 joy, u16 changed, u16 state);
+
 // game result screen
 void showGameResult();
 void handleGameResultInput(u16 joy, u16 changed, u16 state);
@@ -119,23 +229,6 @@ void hidePauseMenu();
 void setPauseMenuVisibility(SpriteVisibility value);
 void handlePauseMenuInput(u16 joy, u16 changed, u16 state);
 
-// game logic
-bool isCorner(int idx);
-bool isSide(int idx);
-bool isMiddle(int idx);
-bool isAdjacentCorner(int idx, int cornerIdx);
-bool isOppositeCorner(int idx, int cornerIdx);
-int countTilesOnWinLine(int line_index, enum SQUARE_STATE state);
-
-bool testWin();
-
-int randomMove();
-bool takeWin(int* squareIndex, enum SQUARE_STATE player);
-bool stopLoss(int* squareIndex, enum SQUARE_STATE player);
-bool addToWinnableLine(int* squareIndex, enum SQUARE_STATE player);
-bool blockLoseableLine(int* squareIndex, enum SQUARE_STATE player);
-int cpuTurn();
-
 /////////////////////////////////////////////////////////////////////////////////////
 // system startup
 /////////////////////////////////////////////////////////////////////////////////////
@@ -187,6 +280,8 @@ void loadPallete()
     VDP_setPaletteColor(0, PAL_getColor(1));
     // Set text colour
     //VDP_setPaletteColor(15, RGB24_TO_VDPCOLOR(0x000000));
+    // keep a copy to fade back in to
+    PAL_getColors(0, game_palette, 64);
 }
 
 void loadSprites()
@@ -207,24 +302,25 @@ void loadSprites()
     setPauseMenuVisibility(HIDDEN);
 }
 
+void initPlaneBuffers()
+{
+    // a plane A nametable has to start on a 0x2000 boundary (256 tiles), a 64x32 plane takes 4KB (128 tiles)
+    curTileInd = (curTileInd + 255) & ~255;
+    plane_a_back = curTileInd * 32;
+    curTileInd += 128;
+    plane_a_front = VDP_BG_A;
+}
+
 
 /////////////////////////////////////////////////////////////////////////////////////
 // general
 /////////////////////////////////////////////////////////////////////////////////////
 
-int randomRange(int min, int max)
-{
-    return (random() % (max - min + 1)) + min;
-}
-
-bool randTest(int percentage)
-{
-    return randomRange(0, 100) < percentage;
-}
-
 void scrollBackground()
 {
-    if ((current_game_state != GAME_PLAYING) && (current_game_state != GAME_RESULT)) return;
+    if ((current_game_state != GAME_PLAYING) && (current_game_state != GAME_RESULT) &&
+        (current_game_state != SIMUL_PLAYING) && (current_game_state != SIMUL_RESULT) &&
+        (current_game_state != PUZZLE_PLAYING) && (current_game_state != PUZZLE_RESULT)) return;
 
     VDP_setVerticalScroll(BG_B, scroll_offset_y--);
     VDP_setHorizontalScroll(BG_B, scroll_offset_x--);
@@ -235,6 +331,9 @@ void scrollBackground()
 
 void handleJoypadInput(u16 joy, u16 changed, u16 state)
 {
+    // no input until the next screen is up
+    if (transition_step != TRANSITION_IDLE) return;
+
     switch (current_game_state)
     {
         case MAIN_MENU:
@@ -258,9 +357,149 @@ void handleJoypadInput(u16 joy, u16 changed, u16 state)
         case PAUSE_MENU:
             handlePauseMenuInput(joy, changed, state);
             break;
+        case SIMUL_PLAYING:
+            handleSimulInput(joy, changed, state);
+            break;
+        case SIMUL_RESULT:
+            handleSimulResultInput(joy, changed, state);
+            break;
+        case PUZZLE_PLAYING:
+            handlePuzzleInput(joy, changed, state);
+            break;
+        case PUZZLE_RESULT:
+            handlePuzzleResultInput(joy, changed, state);
+            break;
+        case BENCHMARK_RESULT:
+            handleBenchmarkResultInput(joy, changed, state);
+            break;
+        default:
+            break;
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// screen transitions
+/////////////////////////////////////////////////////////////////////////////////////
+
+void startTransition(enum GAME_STATE scene, bool fade)
+{
+    transition_scene = scene;
+    transition_fade = fade;
+    transition_frames = 0;
+    transition_stall_max = 0;
+    transition_step = fade ? TRANSITION_FADE_OUT : TRANSITION_CLEAR;
+    if (fade) PAL_fadeOutAll(TRANSITION_FADE_FRAMES, TRUE);
+}
+
+void updateTransition()
+{
+    if (transition_step == TRANSITION_IDLE) return;
+
+    u32 start = getSubTick();
+    transition_frames++;
+
+    switch (transition_step)
+    {
+        case TRANSITION_FADE_OUT:
+            if (!PAL_isDoingFade()) transition_step = TRANSITION_CLEAR;
+            break;
+
+        case TRANSITION_CLEAR:
+            // dma fill of the back buffer, the frame carries on while it runs - uploads still scheduled for the old screen go first
+            if (isDmaScheduled() || GET_VDPSTATUS(VDP_DMABUSY_FLAG)) break;
+            bga_addr = plane_a_back;
+            VDP_clearPlane(BG_A, FALSE);
+            bga_addr = plane_a_front;
+            transition_step = transition_fade ? TRANSITION_CLEAR_BG_B : TRANSITION_COMPOSE;
+            break;
+
+        case TRANSITION_CLEAR_BG_B:
+            // the scrolling background is only touched while faded out - the game redraws it, menus leave it empty
+            if (GET_VDPSTATUS(VDP_DMABUSY_FLAG)) break;
+            VDP_clearPlane(BG_B, FALSE);
+            transition_step = TRANSITION_COMPOSE;
+            break;
+
+        case TRANSITION_COMPOSE:
+            // from here on everything drawn to plane A lands on the incoming screen
+            if (GET_VDPSTATUS(VDP_DMABUSY_FLAG)) break;
+            // the whole scene fits in the dma schedule, so this frame only builds it - the uploads run in the frames after
+            bga_addr = plane_a_back;
+            composeScene(transition_scene);
+            KLog_U2("transition compose subticks ", getSubTick() - start, " dma requests ", scheduledDmaRequests());
+            transition_step = TRANSITION_FLIP;
+            break;
+
+        case TRANSITION_FLIP:
+            // shown from the next vblank (flipPlaneA), once the scheduler has uploaded all of it
+            if (isDmaScheduled()) break;
+            plane_flip_pending = TRUE;
+            transition_step = TRANSITION_DONE;
+            break;
+
+        case TRANSITION_DONE:
+            if (plane_flip_pending) break;
+            plane_a_back = plane_a_front;
+            plane_a_front = bga_addr;
+            if (transition_fade) PAL_fadeInAll(game_palette, TRANSITION_FADE_FRAMES, TRUE);
+            transition_step = TRANSITION_IDLE;
+            break;
+
+        default:
+            break;
+    }
+
+    u32 elapsed = getSubTick() - start;
+    if (elapsed > transition_stall_max) transition_stall_max = elapsed;
+    if (transition_step == TRANSITION_IDLE) KLog_U3("transition to ", transition_scene, " frames ", transition_frames, " worst frame subticks ", transition_stall_max);
+}
+
+void composeScene(enum GAME_STATE scene)
+{
+    switch (scene)
+    {
+        case MAIN_MENU:
+            startMainMenu();
+            break;
+        case CREDITS:
+            startCredits();
+            break;
+        case SELECT_OPPONENT:
+            startSelectOpponentMenu();
+            break;
+        case SELECT_PLAYER2_INPUT:
+            StartSelectPlayer2Menu();
+            break;
+        case GAME_PLAYING:
+            startGame(game_opponent);
+            break;
+        case SIMUL_PLAYING:
+            startSimul(game_opponent);
+            break;
+        case PUZZLE_PLAYING:
+            startPuzzles();
+            break;
+        case BENCHMARK:
+            startBenchmark();
+            break;
+        case BENCHMARK_RESULT:
+            showBenchmarkResult();
+            break;
+        default:
+            break;
     }
 }
 
+void flipPlaneA()
+{
+    // main thread vblank callback (SYS_doVBlankProcess) - a single register write swaps the visible plane A,
+    // never in the middle of a VDP control port sequence of the frame code as it could be from the interrupt
+    if (!plane_flip_pending) return;
+    VDP_setReg(2, bga_addr >> 10);
+    plane_flip_pending = FALSE;
+}
+
 
 /////////////////////////////////////////////////////////////////////////////////////
 // main menu handling
@@ -272,12 +511,17 @@ void startMainMenu()
     selected_menu_option = MAIN_MENU_1_PLAY;
 
     // draw the logo image
-    VDP_setTileMapEx(BG_A, img_title.tilemap, title_basetile, (40 - img_title.tilemap->w) / 2, 5, 0, 0, img_title.tilemap->w, img_title.tilemap->h, DMA);
+    scheduleTileMap(BG_A, img_title.tilemap, title_basetile, (40 - img_title.tilemap->w) / 2, 5, 0, 0, img_title.tilemap->w, img_title.tilemap->h);
 
     // draw the menu items
-    VDP_drawText("1 PLAYER", 16, 16);
-    VDP_drawText("2 PLAYERS", 16, 18);
-    VDP_drawText("CREDITS", 16, 20);
+    VDP_drawText("1 PLAYER", 16, 14);
+    VDP_drawText("2 PLAYERS", 16, 16);
+    VDP_drawText("SIMUL", 16, 18);
+    VDP_drawText("PUZZLES", 16, 20);
+    VDP_drawText("CREDITS", 16, 22);
+    VDP_drawText(music_enabled ? "MUSIC ON " : "MUSIC OFF", 16, 24);
+    VDP_drawText("RULES", 16, 26);
+    VDP_drawText(rule_names[selected_rules], 22, 26);
 
     // draw the current selections
     updateMainMenu();
@@ -286,52 +530,82 @@ void startMainMenu()
 void updateMainMenu()
 {
     // clear previous selections
+    VDP_clearText(14, 14, 1);
     VDP_clearText(14, 16, 1);
     VDP_clearText(14, 18, 1);
     VDP_clearText(14, 20, 1);
+    VDP_clearText(14, 22, 1);
+    VDP_clearText(14, 24, 1);
+    VDP_clearText(14, 26, 1);
     // show marker for current selection
-    if (selected_menu_option == MAIN_MENU_1_PLAY) VDP_drawText(">", 14, 16);
-    if (selected_menu_option == MAIN_MENU_2_PLAY) VDP_drawText(">", 14, 18);
-    if (selected_menu_option == MAIN_MENU_CREDITS) VDP_drawText(">", 14, 20);
-}
-
-void clearMainMenu()
-{
-    VDP_clearPlane(BG_A, TRUE);
+    if (selected_menu_option == MAIN_MENU_1_PLAY) VDP_drawText(">", 14, 14);
+    if (selected_menu_option == MAIN_MENU_2_PLAY) VDP_drawText(">", 14, 16);
+    if (selected_menu_option == MAIN_MENU_SIMUL) VDP_drawText(">", 14, 18);
+    if (selected_menu_option == MAIN_MENU_PUZZLES) VDP_drawText(">", 14, 20);
+    if (selected_menu_option == MAIN_MENU_CREDITS) VDP_drawText(">", 14, 22);
+    if (selected_menu_option == MAIN_MENU_MUSIC) VDP_drawText(">", 14, 24);
+    if (selected_menu_option == MAIN_MENU_RULES) VDP_drawText(">", 14, 26);
 }
 
 void handleMenuInput(u16 joy, u16 changed, u16 state)
 {
+    // hidden benchmark
+    if ((state & changed & BUTTON_START) && ((state & (BUTTON_B | BUTTON_C)) == (BUTTON_B | BUTTON_C)))
+    {
+        startTransition(BENCHMARK, FALSE);
+        return;
+    }
+
+    // toggle music
+    if ((state & changed & BUTTON_A) && (selected_menu_option == MAIN_MENU_MUSIC))
+    {
+        music_enabled = !music_enabled;
+        VDP_drawText(music_enabled ? "MUSIC ON " : "MUSIC OFF", 16, 24);
+        return;
+    }
+
+    // rule variant for 1 and 2 player games (simul and link play keep the standard rules)
+    if ((state & changed & (BUTTON_A | BUTTON_RIGHT | BUTTON_LEFT)) && (selected_menu_option == MAIN_MENU_RULES))
+    {
+        selected_rules = (selected_rules + ((state & changed & BUTTON_LEFT) ? 3 : 1)) % 4;
+        VDP_drawText(rule_names[selected_rules], 22, 26);
+        return;
+    }
+
     // player has selected an option
     if (state & changed & BUTTON_A)
     {
-        // clear the menu
-        clearMainMenu();
-        
         // player 1 select opponent
-        if (selected_menu_option == MAIN_MENU_1_PLAY)
+        if ((selected_menu_option == MAIN_MENU_1_PLAY) || (selected_menu_option == MAIN_MENU_SIMUL))
         {
-            startSelectOpponentMenu();
+            startTransition(SELECT_OPPONENT, FALSE);
             return;
         }
         
         // start 2 player game
         if (selected_menu_option == MAIN_MENU_2_PLAY)
         {
-            StartSelectPlayer2Menu(PLAYER_2);
+            startTransition(SELECT_PLAYER2_INPUT, FALSE);
             return;
         }
         
+        // puzzles, straight in
+        if (selected_menu_option == MAIN_MENU_PUZZLES)
+        {
+            startTransition(PUZZLE_PLAYING, TRUE);
+            return;
+        }
+
         // credits menu
         if (selected_menu_option == MAIN_MENU_CREDITS)
         {
-            startCredits();
+            startTransition(CREDITS, FALSE);
             return;
         }
     }
 
     if ((state & changed & BUTTON_UP) && (selected_menu_option > MAIN_MENU_1_PLAY)) selected_menu_option--;
-    if ((state & changed & BUTTON_DOWN) && (selected_menu_option < MAIN_MENU_CREDITS)) selected_menu_option++;
+    if ((state & changed & BUTTON_DOWN) && (selected_menu_option < MAIN_MENU_RULES)) selected_menu_option++;
 
     updateMainMenu();
     return;
@@ -347,7 +621,7 @@ void startCredits()
     current_game_state = CREDITS;
 
     // draw the logo image
-    VDP_setTileMapEx(BG_A, img_title.tilemap, title_basetile, 0, 0, 0, 0, img_title.tilemap->w, img_title.tilemap->h, DMA);
+    scheduleTileMap(BG_A, img_title.tilemap, title_basetile, 0, 0, 0, 0, img_title.tilemap->w, img_title.tilemap->h);
 
     // draw the credits
     VDP_drawText("PROGRAMMING", 1, 8);
@@ -362,17 +636,11 @@ void startCredits()
     VDP_drawText("FEEL FREE TO SHARE/MAKE COPIES", 1, 26);
 }
 
-void clearCredits()
-{
-    VDP_clearPlane(BG_A, TRUE);
-}
-
 void handleCreditsInput(u16 joy, u16 changed, u16 state)
 {
     if ((state & changed & BUTTON_A) || (state & changed & BUTTON_B) || (state & changed & BUTTON_C) || (state & changed & BUTTON_START))
     {
-        clearCredits();
-        startMainMenu();
+        startTransition(MAIN_MENU, FALSE);
     }
 }
 
@@ -385,9 +653,10 @@ void startSelectOpponentMenu()
 {
     current_game_state = SELECT_OPPONENT;
     game_opponent = CPU_EASY;
+    selected_limit_field = LIMIT_NONE;
 
     // draw title image
-    VDP_setTileMapEx(BG_A, img_title.tilemap, title_basetile, (40 - img_title.tilemap->w) / 2, 5, 0, 0, img_title.tilemap->w, img_title.tilemap->h, DMA);
+    scheduleTileMap(BG_A, img_title.tilemap, title_basetile, (40 - img_title.tilemap->w) / 2, 5, 0, 0, img_title.tilemap->w, img_title.tilemap->h);
 
     // draw the menu items
     VDP_drawText("SELECT DIFFICULTY", 10, 14);
@@ -395,6 +664,9 @@ void startSelectOpponentMenu()
     VDP_drawText("MEDIUM", 16, 19);
     VDP_drawText("HARD", 16, 21);
 
+    // simul also picks the number of boards
+    if (selected_menu_option == MAIN_MENU_SIMUL) VDP_drawText("BOARDS <   >", 14, 24);
+
     // draw the current selections
     updateSelectOpponentMenu();
 }
@@ -410,11 +682,66 @@ void updateSelectOpponentMenu()
     if (game_opponent == CPU_EASY) VDP_drawText(">", 14, 17);
     if (game_opponent == CPU_MEDIUM) VDP_drawText(">", 14, 19);
     if (game_opponent == CPU_HARD) VDP_drawText(">", 14, 21);
+
+    if (selected_menu_option == MAIN_MENU_SIMUL)
+    {
+        char s[2] = { '0' + simul_board_count, 0 };
+        VDP_drawText(s, 23, 24);
+    }
+
+    drawDifficultyLimits();
 }
 
-void clearSelectOpponentMenu()
+void drawDifficultyLimits()
 {
-    VDP_clearPlane(BG_A, TRUE);
+    SearchLimits* limits = &difficulty_limits[game_opponent];
+    char s[8];
+
+    // search limits of the selected difficulty, B picks one to change with left / right
+    VDP_clearText(4, 26, 32);
+    VDP_drawText("NODES", 5, 26);
+    VDP_drawText("DEPTH", 17, 26);
+    VDP_drawText("NOISE", 26, 26);
+    intToStr(limits->max_nodes, s, 1);
+    VDP_drawText(s, 11, 26);
+    intToStr(limits->max_depth, s, 1);
+    VDP_drawText(s, 23, 26);
+    intToStr(limits->noise, s, 1);
+    VDP_drawText(s, 32, 26);
+
+    if (selected_limit_field == LIMIT_NODES) VDP_drawText(">", 4, 26);
+    if (selected_limit_field == LIMIT_DEPTH) VDP_drawText(">", 16, 26);
+    if (selected_limit_field == LIMIT_NOISE) VDP_drawText(">", 25, 26);
+
+    // the most a cpu move can cost at these limits, under the rules being played
+    u32 cycles = searchWorstCase(limits);
+    VDP_clearText(4, 27, 32);
+    VDP_drawText("WORST CASE", 7, 27);
+    intToStr(cycles, s, 1);
+    VDP_drawText(s, 18, 27);
+    VDP_drawText("CYCLES", 26, 27);
+}
+
+void changeDifficultyLimit(int direction)
+{
+    SearchLimits* limits = &difficulty_limits[game_opponent];
+
+    if (selected_limit_field == LIMIT_NODES)
+    {
+        if ((direction < 0) && (limits->max_nodes > 4)) limits->max_nodes -= 4;
+        else if ((direction < 0) && (limits->max_nodes > 1)) limits->max_nodes--;
+        if ((direction > 0) && (limits->max_nodes < 400)) limits->max_nodes += limits->max_nodes < 4 ? 1 : 4;
+    }
+    if (selected_limit_field == LIMIT_DEPTH)
+    {
+        if ((direction < 0) && (limits->max_depth > 1)) limits->max_depth--;
+        if ((direction > 0) && (limits->max_depth < 9)) limits->max_depth++;
+    }
+    if (selected_limit_field == LIMIT_NOISE)
+    {
+        if ((direction < 0) && (limits->noise >= 10)) limits->noise -= 10;
+        if ((direction > 0) && (limits->noise <= 240)) limits->noise += 10;
+    }
 }
 
 void handleSelectOpponentInput(u16 joy, u16 changed, u16 state)
@@ -425,21 +752,38 @@ void handleSelectOpponentInput(u16 joy, u16 changed, u16 state)
         // player 1 select opponent
         if (selected_menu_option == MAIN_MENU_1_PLAY)
         {
-            clearSelectOpponentMenu();
-            startGame(game_opponent);
+            startTransition(GAME_PLAYING, TRUE);
+            return;
+        }
+
+        if (selected_menu_option == MAIN_MENU_SIMUL)
+        {
+            startTransition(SIMUL_PLAYING, TRUE);
             return;
         }
     }
 
     if (state & changed & BUTTON_C)
     {
-        clearSelectOpponentMenu();
-        startMainMenu();
+        startTransition(MAIN_MENU, FALSE);
         return;
     }
 
+    // B steps through the search limits of the difficulty, left / right then change the one picked
+    if (state & changed & BUTTON_B) selected_limit_field = (selected_limit_field + 1) % (LIMIT_NOISE + 1);
+
     if ((state & changed & BUTTON_UP) && (game_opponent > CPU_EASY)) game_opponent--;
     if ((state & changed & BUTTON_DOWN) && (game_opponent < CPU_HARD)) game_opponent++;
+    if (selected_limit_field != LIMIT_NONE)
+    {
+        if (state & changed & BUTTON_LEFT) changeDifficultyLimit(-1);
+        if (state & changed & BUTTON_RIGHT) changeDifficultyLimit(1);
+    }
+    else
+    {
+        if ((state & changed & BUTTON_LEFT) && (simul_board_count > 1)) simul_board_count--;
+        if ((state & changed & BUTTON_RIGHT) && (simul_board_count < 4)) simul_board_count++;
+    }
 
     updateSelectOpponentMenu();
 }
@@ -455,12 +799,13 @@ void StartSelectPlayer2Menu()
     player2_pad = JOY_1;
 
     // draw title image
-    VDP_setTileMapEx(BG_A, img_title.tilemap, title_basetile, (40 - img_title.tilemap->w) / 2, 5, 0, 0, img_title.tilemap->w, img_title.tilemap->h, DMA);
+    scheduleTileMap(BG_A, img_title.tilemap, title_basetile, (40 - img_title.tilemap->w) / 2, 5, 0, 0, img_title.tilemap->w, img_title.tilemap->h);
 
     // draw the menu items
     VDP_drawText("ASSIGN PLAYER 2", 13, 14);
     VDP_drawText("SHARE PAD 1", 16, 17);
     VDP_drawText("PAD 2", 16, 19);
+    VDP_drawText("LINK CABLE", 16, 21);
 
     // draw the current selections
     UpdateSelectPlayer2Menu();
@@ -471,43 +816,173 @@ void UpdateSelectPlayer2Menu()
     // clear previous selections
     VDP_clearText(14, 17, 1);
     VDP_clearText(14, 19, 1);
+    VDP_clearText(14, 21, 1);
 
     // show marker for current selection
     if (player2_pad == JOY_1) VDP_drawText(">", 14, 17);
     if (player2_pad == JOY_2) VDP_drawText(">", 14, 19);
-}
-
-void clearSelectPlayer2Menu()
-{
-    VDP_clearPlane(BG_A, TRUE);
+    if (player2_pad == LINK_PAD) VDP_drawText(">", 14, 21);
 }
 
 void handleSelectPlayer2Input(u16 joy, u16 changed, u16 state)
 {
+    // waiting for the other console - C gives up
+    if (link_play)
+    {
+        if (state & changed & BUTTON_C)
+        {
+            stopLinkPlay();
+            VDP_clearText(12, 24, 16);
+        }
+        return;
+    }
+
     // player has selected an option
     if (state & changed & BUTTON_A)
     {
-        clearSelectPlayer2Menu();
-        startGame(PLAYER_2);
+        // the game starts once the other console answers (updateLink)
+        if (player2_pad == LINK_PAD)
+        {
+            startLinkPlay();
+            VDP_drawText("WAITING FOR LINK", 12, 24);
+            return;
+        }
+
+        game_opponent = PLAYER_2;
+        startTransition(GAME_PLAYING, TRUE);
         return;
     }
 
     // back to main menu
     if (state & changed & BUTTON_C)
     {
-        clearSelectPlayer2Menu();
-        startMainMenu();
+        startTransition(MAIN_MENU, FALSE);
         return;
     }
 
-    if (state & changed & BUTTON_UP) player2_pad = JOY_1;
-    if (state & changed & BUTTON_DOWN) player2_pad = JOY_2;
+    if (state & changed & BUTTON_UP) player2_pad = player2_pad == LINK_PAD ? JOY_2 : JOY_1;
+    if (state & changed & BUTTON_DOWN) player2_pad = player2_pad == JOY_1 ? JOY_2 : LINK_PAD;
 
     UpdateSelectPlayer2Menu();
     return;
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////////
+// link play
+/////////////////////////////////////////////////////////////////////////////////////
+
+void startLinkPlay()
+{
+    link_play = TRUE;
+    link_moves = 0;
+    startLinkPort();
+    startLink(&link_session, LINK_INPUT_DELAY);
+}
+
+void stopLinkPlay()
+{
+    stopLinkPort();
+    link_play = FALSE;
+    KLog_U3("link rtt frames ", link_session.rtt, " max ", link_session.rtt_max, " stalled frames ", link_session.stall_frames);
+}
+
+u8 linkButtons(u16 state)
+{
+    // the pad bits up..right are the link bits already
+    u8 buttons = state & (LINK_UP | LINK_DOWN | LINK_LEFT | LINK_RIGHT);
+    if (state & BUTTON_A) buttons |= LINK_A;
+    if (state & BUTTON_C) buttons |= LINK_C;
+    return buttons;
+}
+
+void updateLink()
+{
+    u8 byte;
+
+    if (!link_play) return;
+
+    while (linkPortRead(&byte)) linkReceive(&link_session, byte);
+
+    // pad 1 goes out every frame
+    bool playing = link_session.state == LINK_PLAYING;
+    u8 buttons = playing ? linkButtons(JOY_readJoypad(JOY_1)) : 0;
+    s16 send = linkSend(&link_session, buttons);
+    if (send >= 0) linkPortWrite(send);
+
+    if (link_session.state == LINK_LOST)
+    {
+        KLog("link lost");
+        if (current_game_state == SELECT_PLAYER2_INPUT)
+        {
+            stopLinkPlay();
+            VDP_drawText("NO LINK         ", 12, 24);
+            return;
+        }
+        // as quitting from the pause menu
+        setUserCursorVisibility(HIDDEN);
+        closeGame();
+        startTransition(MAIN_MENU, TRUE);
+        return;
+    }
+
+    // both consoles are talking - into the game
+    if (playing && (current_game_state == SELECT_PLAYER2_INPUT) && (transition_step == TRANSITION_IDLE))
+    {
+        game_opponent = PLAYER_2;
+        startTransition(GAME_PLAYING, TRUE);
+        return;
+    }
+
+    // the board only changes on lockstep frames, never while a screen is being built
+    if ((transition_step != TRANSITION_IDLE) || ((current_game_state != GAME_PLAYING) && (current_game_state != GAME_RESULT))) return;
+
+    // at most two lockstep frames a frame, to catch up after a wait
+    u8 pressed[2];
+    for(int step=0; (step < 2) && link_play && linkStep(&link_session, pressed); step++)
+    {
+        u8 square = selected_square;
+        enum LINK_ACTION action = linkAction(&game_board, current_game_state == GAME_RESULT, pressed, &square);
+        selected_square = square;
+        applyLinkAction(action);
+    }
+
+    // the local cursor moves ahead of the lockstep on the presses already sent, replayed from where the lockstep
+    // has it - so a press made on the other player's turn shows once the turn comes round
+    u8 predicted = current_game_state == GAME_PLAYING ? linkPredictCursor(&link_session, &game_board, selected_square) : selected_square;
+    if (predicted != predicted_square)
+    {
+        predicted_square = predicted;
+        drawCursor(predicted);
+    }
+}
+
+void applyLinkAction(enum LINK_ACTION action)
+{
+    switch (action)
+    {
+        case LINK_TAKE:
+            // (the cursor is redrawn from the lockstep's square after the steps, updateLink)
+            link_moves++;
+            takeSquare(selected_square, game_board.current_player);
+            break;
+
+        case LINK_NEXT_GAME:
+            current_game_state = GAME_PLAYING;
+            resetGame();
+            break;
+
+        case LINK_QUIT:
+            closeGame();
+            startTransition(MAIN_MENU, TRUE);
+            break;
+
+        default:
+            break;
+    }
+}
+
+
 /////////////////////////////////////////////////////////////////////////////////////
 // pause menu
 /////////////////////////////////////////////////////////////////////////////////////
@@ -516,6 +991,7 @@ void startPauseMenu()
 {
     // pause menu mode
     selected_menu_option = 0;
+    paused_game_state = current_game_state;
     current_game_state = PAUSE_MENU;
     // Show pause menu sprites
     setPauseMenuVisibility(VISIBLE);
@@ -523,7 +999,7 @@ void startPauseMenu()
     // Hide user icon sprite
     setUserCursorVisibility(HIDDEN);
     // Pause music
-    XGM_pausePlay();
+    if (music_enabled) XGM_pausePlay();
 }
 
 void hidePauseMenu()
@@ -533,9 +1009,9 @@ void hidePauseMenu()
     // Show user icon sprite
     setUserCursorVisibility(VISIBLE);
     // Resume Music
-    XGM_resumePlay();
+    if (music_enabled) XGM_resumePlay();
     // back to game mode
-    current_game_state = GAME_PLAYING;
+    current_game_state = paused_game_state;
 }
 
 void setPauseMenuVisibility(SpriteVisibility value)
@@ -561,7 +1037,7 @@ void handlePauseMenuInput(u16 joy, u16 changed, u16 state)
     if (state & changed & BUTTON_A)
     {
         closeGame();
-        startMainMenu();
+        startTransition(MAIN_MENU, TRUE);
         return;
     }
 }
@@ -571,21 +1047,58 @@ void handlePauseMenuInput(u16 joy, u16 changed, u16 state)
 // save state
 /////////////////////////////////////////////////////////////////////////////////////
 
+u16 scoreSram(enum OPPONENT_TYPE opponent)
+{
+    // played, won and lost against each opponent, under the rules of this game
+    if (game_rules == RULES_STANDARD) return sizeof(u32) * (opponent * 3);
+    return VARIANT_SCORE_SRAM + sizeof(u32) * (((game_rules - 1) * (CPU_HARD + 1) + opponent) * 3);
+}
+
 void loadScores(enum OPPONENT_TYPE opponent)
 {
+    u16 offset = scoreSram(opponent);
     SRAM_enableRO();
-    games_played = SRAM_readLong(sizeof(u32) * (opponent * 3 + 0));
-    games_won = SRAM_readLong(sizeof(u32) * (opponent * 3 + 1));
-    games_lost = SRAM_readLong(sizeof(u32) * (opponent * 3 + 2));
+    games_played = SRAM_readLong(offset + 0);
+    games_won = SRAM_readLong(offset + 4);
+    games_lost = SRAM_readLong(offset + 8);
     SRAM_disable();
+
+    // a save from before the variants never wrote theirs
+    if (games_played == 0xFFFFFFFF)
+    {
+        games_played = 0;
+        games_won = 0;
+        games_lost = 0;
+    }
 }
 
 void saveScores(enum OPPONENT_TYPE opponent)
 {
+    u16 offset = scoreSram(opponent);
+    SRAM_enable();
+    SRAM_writeLong(offset + 0, games_played);
+    SRAM_writeLong(offset + 4, games_won);
+    SRAM_writeLong(offset + 8, games_lost);
+    SRAM_disable();
+}
+
+void loadPuzzleProgress()
+{
+    // after the scores of every opponent - a blank save starts from the first puzzle
+    SRAM_enableRO();
+    puzzle_index = SRAM_readWord(PUZZLE_SRAM);
+    puzzles_solved = SRAM_readWord(PUZZLE_SRAM + sizeof(u16));
+    SRAM_disable();
+    if (puzzle_index >= PUZZLE_COUNT) puzzle_index = 0;
+    if (puzzles_solved == 0xFFFF) puzzles_solved = 0;
+}
+
+void savePuzzleProgress(u16 index)
+{
+    // index is the puzzle to start from next time
     SRAM_enable();
-    SRAM_writeLong(sizeof(u32) * (opponent * 3 + 0), games_played);
-    SRAM_writeLong(sizeof(u32) * (opponent * 3 + 1), games_won);
-    SRAM_writeLong(sizeof(u32) * (opponent * 3 + 2), games_lost);
+    SRAM_writeWord(PUZZLE_SRAM, index);
+    SRAM_writeWord(PUZZLE_SRAM + sizeof(u16), puzzles_solved);
     SRAM_disable();
 }
 
@@ -596,43 +1109,42 @@ void saveScores(enum OPPONENT_TYPE opponent)
 
 void startGame(enum OPPONENT_TYPE opponent)
 {
-    // Set the opponent
+    // Set the opponent and the rules
     game_opponent = opponent;
+    game_rules = link_play ? RULES_STANDARD : selected_rules;
     // Load scores from SRAM
     loadScores(opponent);
     // Set the game state
     current_game_state = GAME_PLAYING;
+    // both ends of a link start from the same board
+    if (link_play) game_board.current_player = CROSS;
     // set the scrolling tiled background
     setBackground();
     // set the scores in the foreground
     setForeground();
     // start playing the music
-    XGM_startPlay(music_bg);
+    if (music_enabled) XGM_startPlay(music_bg);
     // reset the game (draws the game board & scores)
     resetGame();
 }
 
 void closeGame()
 {
-    VDP_clearPlane(BG_A, TRUE);
-    VDP_clearPlane(BG_B, TRUE);
+    // both planes are cleared by the transition out, while faded
     // Hide pause menu sprites
     setPauseMenuVisibility(HIDDEN);
     // Stop music
-    XGM_stopPlay();
+    if (music_enabled) XGM_stopPlay();
+    stopPieceAnims();
+    pending_numbers = 0;
+    analysis_pending = FALSE;
+    if (link_play) stopLinkPlay();
 }
 
 void setBackground()
 {
-    // draw background image
-    int w = 64 / img_bg.tilemap->w;
-    int h = 32 / img_bg.tilemap->h;
-
-    for(int i=0; i<w; i++) {
-        for(int j=0; j<h; j++) {
-            VDP_setTileMapEx(BG_B, img_bg.tilemap, bg_basetile, i * img_bg.tilemap->w, j * img_bg.tilemap->h, 0, 0, img_bg.tilemap->w, img_bg.tilemap->h, DMA);
-        }
-    }
+    // tile the background image over the whole 64x32 plane, a few rows a frame
+    scheduleTileMapRepeat(BG_B, img_bg.tilemap, bg_basetile, 0, 0, 64, 32);
 }
 
 void setForeground()
@@ -662,8 +1174,8 @@ void setForeground()
     }
 
     // draw the player images
-    VDP_setTileMapEx(BG_A, img_crossbg.tilemap, crossbg_basetile, 30, 1, 0, 0, img_crossbg.tilemap->w, img_crossbg.tilemap->h, DMA);
-    VDP_setTileMapEx(BG_A, img_noughtbg.tilemap, noughtbg_basetile, 30, 18, 0, 0, img_noughtbg.tilemap->w, img_noughtbg.tilemap->h, DMA);
+    scheduleTileMap(BG_A, img_crossbg.tilemap, crossbg_basetile, 30, 1, 0, 0, img_crossbg.tilemap->w, img_crossbg.tilemap->h);
+    scheduleTileMap(BG_A, img_noughtbg.tilemap, noughtbg_basetile, 30, 18, 0, 0, img_noughtbg.tilemap->w, img_noughtbg.tilemap->h);
 }
 
 void setUserCursorVisibility(SpriteVisibility value)
@@ -686,50 +1198,113 @@ void drawGameScores()
     VDP_drawText(s, 30, 26);
 }
 
-void drawGameBoardSquare(int square, enum SQUARE_STATE state)
+void drawGameBoardSquare(int square, u8 piece)
 {
     u16 x = (square % 3 * 9) + 1;
     u16 y = (square / 3 * 9) + 1;
     
-    if (state == EMPTY) VDP_setTileMapEx(BG_A, img_empty.tilemap, square_basetile, x, y, 0, 0, img_empty.tilemap->w, img_empty.tilemap->h, DMA);
-    if (state == CROSS) VDP_setTileMapEx(BG_A, img_cross.tilemap, cross_basetile, x, y, 0, 0, img_cross.tilemap->w, img_cross.tilemap->h, DMA);
-    if (state == NOUGHT) VDP_setTileMapEx(BG_A, img_nought.tilemap, nought_basetile, x, y, 0, 0, img_nought.tilemap->w, img_nought.tilemap->h, DMA);
+    if (piece == EMPTY)
+    {
+        stopPieceAnim(x, y);
+        scheduleTileMap(BG_A, img_empty.tilemap, square_basetile, x, y, 0, 0, img_empty.tilemap->w, img_empty.tilemap->h);
+        return;
+    }
+
+    // numbers are written over the empty square once it is uploaded (updateNumbers)
+    if (game_rules == RULES_NUMERICAL)
+    {
+        pending_numbers |= 1 << square;
+        return;
+    }
+
+    // pieces are drawn in over the next frames (updatePieceAnims)
+    if (piece == CROSS) startPieceAnim(x, y, &img_cross, cross_basetile, cross_reveal);
+    if (piece == NOUGHT) startPieceAnim(x, y, &img_nought, nought_basetile, nought_reveal);
+}
+
+void updateNumbers()
+{
+    char s[2] = { 0, 0 };
+
+    // the empty squares are still being uploaded
+    if (!pending_numbers || isDmaScheduled()) return;
+
+    for(int i=0; i<9; i++)
+    {
+        if (!(pending_numbers & (1 << i))) continue;
+        s[0] = '0' + game_board.squares[i];
+        VDP_drawText(s, (i % 3 * 9) + 4, (i / 3 * 9) + 4);
+    }
+    pending_numbers = 0;
+}
+
+void drawSelectedPiece()
+{
+    // the rules, and what A puts down - C picks another mark or number where there is a choice
+    VDP_clearText(30, 11, 10);
+    VDP_clearText(30, 12, 10);
+    if (game_rules == RULES_STANDARD) return;
+    VDP_drawText(rule_names[game_rules], 30, 11);
+
+    if ((game_rules != RULES_WILD) && (game_rules != RULES_NUMERICAL)) return;
+    char s[2] = { game_rules == RULES_WILD ? (selected_piece == CROSS ? 'X' : 'O') : '0' + selected_piece, 0 };
+    VDP_drawText("PIECE:", 30, 12);
+    VDP_drawText(s, 37, 12);
 }
 
-void takeSquare(int squareindex)
+void takeSquare(int squareindex, u8 piece)
 {
     // check square is available
-    if (game_board[squareindex] != EMPTY) return;
+    if (game_board.squares[squareindex] != EMPTY) return;
 
     // take the square
-    game_board[squareindex] = current_player;
-    moves_history[9-moves_remaining] = squareindex;
-    moves_remaining--;
+    bool win = placeMove(&game_board, squareindex, piece);
 
     // draw the square
-    drawGameBoardSquare(squareindex, current_player);
+    drawGameBoardSquare(squareindex, piece);
 
-    // check for win
-    if (testWin() == TRUE)
+    // check for win - a line wins for whoever made it, except under misere
+    if (win == TRUE)
     {
-        if (current_player == CROSS) games_lost++;
-        if (current_player == NOUGHT) games_won++;
-        moves_remaining = 0;
+        enum SQUARE_STATE winner = lineWinner(&game_board);
+        if (winner == CROSS) games_lost++;
+        if (winner == NOUGHT) games_won++;
+        game_board.moves_remaining = 0;
     }
 
     // next player
-    current_player = current_player == CROSS ? NOUGHT : CROSS;
+    nextPlayer(&game_board);
+    selected_piece = nextPiece(&game_board, 0);
+    drawSelectedPiece();
 
     // end of game
-    if (moves_remaining == 0)
+    if (game_board.moves_remaining == 0)
     {
+        analysis_pending = FALSE;
+        if (analysis_enabled) clearAnalysis();
         games_played++;
         showGameResult();
         return;
     }
+
+    // re-evaluate the new position
+    startAnalysis();
     
     // Take CPU turn
-    if ((game_opponent != PLAYER_2) && (current_player == NOUGHT)) takeSquare(cpuTurn());
+    if ((game_opponent != PLAYER_2) && (game_board.current_player == NOUGHT)) takeCpuTurn();
+}
+
+void takeCpuTurn()
+{
+    u32 start = getSubTick();
+    u8 piece;
+    int square = cpuMove(&game_board, &piece);
+    u32 subticks = getSubTick() - start;
+
+    // 68000 time spent on the turn, ~100 cycles per subtick
+    u32 cycles = subticks * ((IS_PALSYSTEM ? 7600489 : 7670453) / SUBTICKPERSECOND);
+    KLog_U2("cpu turn subticks ", subticks, " cycles ", cycles);
+    takeSquare(square, piece);
 }
 
 void resetGame()
@@ -738,293 +1313,701 @@ void resetGame()
     setUserCursorVisibility(VISIBLE);
 
     // empty all squares on the game board
-    for(int i=0; i<9; i++) {
-        drawGameBoardSquare(i, EMPTY);
-        game_board[i] = EMPTY;
-    }
+    clearBoard(&game_board);
+    for(int i=0; i<9; i++) drawGameBoardSquare(i, EMPTY);
 
     // draw the game scores    
     drawGameScores();
 
     // reset game flags
-    moves_remaining = 9;
+    pending_numbers = 0;
+    selected_piece = nextPiece(&game_board, 0);
+    drawSelectedPiece();
     setSelectedSquare(4);
+    startAnalysis();
 
     // If it is the CPU's turn - take it
-    if ((game_opponent != PLAYER_2) && (current_player == NOUGHT)) takeSquare(cpuTurn());
+    if ((game_opponent != PLAYER_2) && (game_board.current_player == NOUGHT)) takeCpuTurn();
 }
 
 void setSelectedSquare(int idx)
 {
     selected_square = idx;
+    predicted_square = idx;
+    drawCursor(idx);
+}
+
+void drawCursor(int idx)
+{
     // move the user cursor sprites
-    SPR_setPosition(user_cursor[0], (selected_square % 3 * 72) + 8, (selected_square / 3 * 72) + 8);
-    SPR_setPosition(user_cursor[1], (selected_square % 3 * 72) + 40, (selected_square / 3 * 72) + 8);
-    SPR_setPosition(user_cursor[2], (selected_square % 3 * 72) + 8, (selected_square / 3 * 72) + 40);
-    SPR_setPosition(user_cursor[3], (selected_square % 3 * 72) + 40, (selected_square / 3 * 72) + 40);
+    SPR_setPosition(user_cursor[0], (idx % 3 * 72) + 8, (idx / 3 * 72) + 8);
+    SPR_setPosition(user_cursor[1], (idx % 3 * 72) + 40, (idx / 3 * 72) + 8);
+    SPR_setPosition(user_cursor[2], (idx % 3 * 72) + 8, (idx / 3 * 72) + 40);
+    SPR_setPosition(user_cursor[3], (idx % 3 * 72) + 40, (idx / 3 * 72) + 40);
 }
 
 void handleGameInput(u16 joy, u16 changed, u16 state)
 {
-    // pause (any pad)
-    if (state & changed & BUTTON_START)
+    // pause (any pad) - not in link play, the other console would carry on
+    if ((state & changed & BUTTON_START) && !link_play)
     {
         startPauseMenu();
         return;
     }
 
+    // analysis overlay on / off (any pad) - its values are for the standard rules
+    if ((state & changed & BUTTON_B) && (game_rules == RULES_STANDARD))
+    {
+        analysis_enabled = !analysis_enabled;
+        if (analysis_enabled) startAnalysis();
+        else
+        {
+            analysis_pending = FALSE;
+            clearAnalysis();
+        }
+        return;
+    }
+
+    // link play moves come from the lockstep (updateLink)
+    if (link_play) return;
+
     // is this pad is the player for the current turn is using
-	if (joy != (current_player == NOUGHT) ? player2_pad : JOY_1) return;
+	if (joy != (game_board.current_player == NOUGHT) ? player2_pad : JOY_1) return;
 
 	if (state & changed & BUTTON_RIGHT) setSelectedSquare((selected_square / 3 * 3) + ((selected_square + 1) % 3));
     if (state & changed & BUTTON_LEFT) setSelectedSquare((selected_square / 3 * 3) + ((selected_square + 2) % 3));
     if (state & changed & BUTTON_UP) setSelectedSquare((selected_square + 6) % 9);
     if (state & changed & BUTTON_DOWN) setSelectedSquare((selected_square + 3) % 9);
-    if (state & changed & BUTTON_A) takeSquare(selected_square);
+
+    // the next mark / number to put down, round to the first after the last
+    if (state & changed & BUTTON_C)
+    {
+        selected_piece = nextPiece(&game_board, selected_piece);
+        if (selected_piece == 0) selected_piece = nextPiece(&game_board, 0);
+        drawSelectedPiece();
+    }
+
+    if (state & changed & BUTTON_A) takeSquare(selected_square, selected_piece);
 }
 
 
 /////////////////////////////////////////////////////////////////////////////////////
-// game result screen
+// analysis overlay
 /////////////////////////////////////////////////////////////////////////////////////
 
-void showGameResult()
+void startAnalysis()
 {
-    current_game_state = GAME_RESULT;
-    // hide the cursor sprites
-    setUserCursorVisibility(HIDDEN); 
-    // Save scores
-    saveScores(game_opponent);
-    // Update the scores
-    drawGameScores();
+    if (!analysis_enabled || (game_rules != RULES_STANDARD)) return;
+
+    // values already on screen belong to the previous position
+    clearAnalysis();
+    analysis_pending = TRUE;
 }
 
-void handleGameResultInput(u16 joy, u16 changed, u16 state)
+void updateAnalysis()
 {
-    if (state & changed & BUTTON_A) 
+    // the empty squares are still being uploaded
+    if (!analysis_pending || (current_game_state != GAME_PLAYING) || isDmaScheduled()) return;
+
+    // every value is a table lookup, so the overlay goes up in the frame it is asked for
+    u32 start = getSubTick();
+    drawAnalysis();
+    analysis_pending = FALSE;
+    KLog_U1("analysis overlay subticks ", getSubTick() - start);
+}
+
+void drawAnalysis()
+{
+    char s[3] = { 0, 0, 0 };
+
+    for(int i=0; i<9; i++)
     {
-        current_game_state = GAME_PLAYING;
-        resetGame();
+        if (game_board.squares[i] != EMPTY) continue;
+
+        // W(in) D(raw) L(oss) for the side to move and the number of moves until the game ends
+        s8 value = moveValue(&game_board, i);
+        if (value == POSITION_UNKNOWN) continue;
+        u8 moves = value == 0 ? game_board.moves_remaining : game_board.moves_remaining + 1 - (value > 0 ? value : -value);
+        s[0] = value > 0 ? 'W' : value < 0 ? 'L' : 'D';
+        s[1] = '0' + moves;
+
+        // over the dot in the middle of the empty square
+        VDP_drawText(s, (i % 3 * 9) + 4, (i / 3 * 9) + 4);
+    }
+}
+
+void clearAnalysis()
+{
+    for(int i=0; i<9; i++)
+    {
+        if (game_board.squares[i] != EMPTY) continue;
+        scheduleTileMap(BG_A, img_empty.tilemap, square_basetile, (i % 3 * 9) + 4, (i / 3 * 9) + 4, 3, 3, 2, 1);
     }
 }
 
 
 /////////////////////////////////////////////////////////////////////////////////////
-// game logic
+// simul
 /////////////////////////////////////////////////////////////////////////////////////
 
-bool isCorner(int idx)
+void startSimul(enum OPPONENT_TYPE opponent)
+{
+    game_opponent = opponent;
+    game_rules = RULES_STANDARD;
+    current_game_state = SIMUL_PLAYING;
+    simul_won = 0;
+    simul_lost = 0;
+    simul_drawn = 0;
+    for(int i=0; i<4; i++) simul_boards[i].current_player = CROSS;
+    // same background and score panel as a normal game
+    setBackground();
+    setForeground();
+    if (music_enabled) XGM_startPlay(music_bg);
+    resetSimul();
+}
+
+void resetSimul()
 {
-    return ((idx == TOP_LEFT) || (idx == TOP_RIGHT) || (idx == BOTTOM_LEFT) || (idx == BOTTOM_RIGHT));
+    current_game_state = SIMUL_PLAYING;
+    setUserCursorVisibility(VISIBLE);
+
+    simul_cpu_board = simul_board_count - 1;
+    for(int b=0; b<simul_board_count; b++)
+    {
+        clearBoard(&simul_boards[b]);
+        // the cpu answers from the frame loop, not from the input handler
+        simul_cpu_pending[b] = (simul_boards[b].current_player == NOUGHT);
+    }
+
+    drawSimulBoards();
+    drawSimulScores();
+    setSimulSelection(0, 4);
+}
+
+void drawSimulBoards()
+{
+    // divide the play area into 4 mini boards
+    for(u16 i=1; i<27; i++)
+    {
+        VDP_setTileMapXY(BG_A, TILE_ATTR_FULL(PAL1, 0, TRUE, FALSE, border_basetile+1), i, 13);
+        VDP_setTileMapXY(BG_A, TILE_ATTR_FULL(PAL1, 0, FALSE, FALSE, border_basetile+1), i, 14);
+        VDP_setTileMapXY(BG_A, TILE_ATTR_FULL(PAL1, 0, FALSE, TRUE, border_basetile+2), 13, i);
+        VDP_setTileMapXY(BG_A, TILE_ATTR_FULL(PAL1, 0, FALSE, FALSE, border_basetile+2), 14, i);
+    }
+
+    for(int b=0; b<simul_board_count; b++)
+    {
+        for(int i=0; i<9; i++) drawSimulSquare(b, i, EMPTY);
+    }
 }
 
-bool isSide(int idx)
+void drawSimulSquare(int board, int square, enum SQUARE_STATE state)
 {
-    return ((idx == TOP_MIDDLE) || (idx == CENTER_LEFT) || (idx == CENTER_RIGHT) || (idx == BOTTOM_MIDDLE));
+    // mini boards are 3x3 squares of 4x4 tiles, the piece is drawn in the middle 2x2 tiles
+    u16 x = (board % 2 * 14) + (square % 3 * 4) + 2;
+    u16 y = (board / 2 * 14) + (square / 3 * 4) + 2;
+
+    if (state == EMPTY) scheduleTileMap(BG_A, img_empty.tilemap, square_basetile, x, y, 3, 3, 2, 2);
+    if (state == CROSS)
+    {
+        VDP_drawText("\\/", x, y);
+        VDP_drawText("/\\", x, y + 1);
+    }
+    if (state == NOUGHT)
+    {
+        VDP_drawText("/\\", x, y);
+        VDP_drawText("\\/", x, y + 1);
+    }
 }
 
-bool isMiddle(int idx)
+void drawSimulScores()
 {
-    return (idx == CENTER_MIDDLE);
+    // same layout as drawGameScores - from point of view of the cpu
+    char s[8];
+    intToStr(simul_lost, s, 8);
+    VDP_drawText(s, 30, 9);
+
+    intToStr(simul_drawn, s, 8);
+    VDP_drawText("Draws:", 30, 13);
+    VDP_drawText(s, 30, 15);
+
+    intToStr(simul_won, s, 8);
+    VDP_drawText(s, 30, 26);
+
+    // worst frame time seen with this many boards, as a percentage of the frame
+    u32 frame = SUBTICKPERSECOND / (IS_PALSYSTEM ? 50 : 60);
+    intToStr(simul_frame_max[simul_board_count - 1] * 100 / frame, s, 3);
+    VDP_drawText("CPU:", 30, 16);
+    VDP_drawText(s, 35, 16);
+    VDP_drawText("%", 38, 16);
 }
 
-bool isAdjacentCorner(int idx, int cornerIdx)
+void setSimulSelection(int board, int square)
 {
-    return ((idx == TOP_LEFT) && (cornerIdx == TOP_RIGHT || cornerIdx == BOTTOM_LEFT)) ||
-            ((idx == TOP_RIGHT) && (cornerIdx == TOP_LEFT || cornerIdx == BOTTOM_RIGHT)) ||
-            ((idx == BOTTOM_RIGHT) && (cornerIdx == TOP_RIGHT || cornerIdx == BOTTOM_LEFT)) ||
-            ((idx == BOTTOM_LEFT) && (cornerIdx == TOP_LEFT || cornerIdx == BOTTOM_RIGHT));
+    simul_selected_board = board;
+    selected_square = square;
+
+    // all 4 cursor corners on one 32x32 square make a small cursor
+    s16 x = ((board % 2 * 14) + (square % 3 * 4) + 1) * 8;
+    s16 y = ((board / 2 * 14) + (square / 3 * 4) + 1) * 8;
+    for(int i=0; i<4; i++) SPR_setPosition(user_cursor[i], x, y);
 }
 
-bool isOppositeCorner(int idx, int cornerIdx)
+void takeSimulSquare(int board, int squareindex)
 {
-    if (idx == TOP_LEFT) return BOTTOM_RIGHT;
-    if (idx == TOP_RIGHT) return BOTTOM_LEFT;
-    if (idx == BOTTOM_LEFT) return TOP_RIGHT;
-    if (idx == BOTTOM_RIGHT) return TOP_LEFT;
-    // should not get here
-    return idx;
+    GameBoard* game = &simul_boards[board];
+
+    // check square is available
+    if ((game->moves_remaining == 0) || (game->squares[squareindex] != EMPTY)) return;
+
+    bool win = placePiece(game, squareindex);
+    drawSimulSquare(board, squareindex, game->current_player);
+
+    // check for win
+    enum SQUARE_STATE winner = win ? game->current_player : EMPTY;
+    if (win == TRUE) game->moves_remaining = 0;
+
+    // next player
+    nextPlayer(game);
+
+    // end of this board
+    if (game->moves_remaining == 0)
+    {
+        finishSimulBoard(board, winner);
+        return;
+    }
+
+    // queue the cpu reply for the next frame
+    if (game->current_player == NOUGHT) simul_cpu_pending[board] = TRUE;
 }
 
-int countTilesOnWinLine(int line_index, enum SQUARE_STATE state)
+void finishSimulBoard(int board, enum SQUARE_STATE winner)
 {
-    int res = 0;
-    for (int i=0; i<3; i++)
+    if (winner == CROSS) simul_lost++;
+    if (winner == NOUGHT) simul_won++;
+    if (winner == EMPTY) simul_drawn++;
+    simul_cpu_pending[board] = FALSE;
+
+    // the round is over when every board is
+    int active = 0;
+    for(int b=0; b<simul_board_count; b++)
+    {
+        if (simul_boards[b].moves_remaining > 0) active++;
+    }
+
+    if (active == 0)
     {
-        if (game_board[winning_lines[line_index][i]] == state) res++;
+        current_game_state = SIMUL_RESULT;
+        setUserCursorVisibility(HIDDEN);
+        KLog_U2("simul boards ", simul_board_count, " worst frame subticks ", simul_frame_max[simul_board_count - 1]);
     }
-    return res;
+
+    drawSimulScores();
 }
 
-int randomMove()
+void updateSimul()
 {
-    int r = randomRange(0, moves_remaining-1);
-    for (int i=0; i<9; i++)
+    // (not before the empty squares are uploaded, they would land on the reply)
+    if ((current_game_state != SIMUL_PLAYING) || isDmaScheduled()) return;
+
+    u32 start = getSubTick();
+
+    // answer one waiting board a frame - a hard search is most of a frame on its own - taking
+    // the boards in turn from the one after the last answered, so none waits behind the others
+    for(int i=1; i<=simul_board_count; i++)
     {
-        if (game_board[i] == EMPTY)
-        {
-            if (r == 0) return i;
-            r--;
-        }
+        int b = (simul_cpu_board + i) % simul_board_count;
+        if (!simul_cpu_pending[b]) continue;
+        simul_cpu_pending[b] = FALSE;
+        simul_cpu_board = b;
+        takeSimulSquare(b, cpuTurn(&simul_boards[b]));
+        break;
     }
 
-    // we should never get here
-    return 0;
+    u32 elapsed = getSubTick() - start;
+    if (elapsed > simul_frame_max[simul_board_count - 1])
+    {
+        simul_frame_max[simul_board_count - 1] = elapsed;
+        drawSimulScores();
+    }
 }
 
-bool takeWin(int* squareIndex, enum SQUARE_STATE player)
+void handleSimulInput(u16 joy, u16 changed, u16 state)
 {
-    for (int line_index=0; line_index<8; line_index++)
+    // pause (any pad)
+    if (state & changed & BUTTON_START)
+    {
+        startPauseMenu();
+        return;
+    }
+
+    // the player plays all boards from pad 1
+    if (joy != JOY_1) return;
+
+    int board = simul_selected_board;
+
+    // jump to the next board that is still in play
+    if (state & changed & BUTTON_B)
     {
-        if ((countTilesOnWinLine(line_index, player) == 2) && (countTilesOnWinLine(line_index, EMPTY) == 1))
+        for(int i=1; i<=simul_board_count; i++)
         {
-            for (int i=0; i<3; i++)
-            {
-                if (game_board[winning_lines[line_index][i]] == EMPTY)
-                {
-                    *squareIndex = winning_lines[line_index][i];
-                    return TRUE;
-                }
-            }
+            board = (simul_selected_board + i) % simul_board_count;
+            if (simul_boards[board].moves_remaining > 0) break;
         }
+        setSimulSelection(board, selected_square);
+        return;
     }
 
-    return FALSE;
+    if (state & changed & BUTTON_RIGHT) setSimulSelection(board, (selected_square / 3 * 3) + ((selected_square + 1) % 3));
+    if (state & changed & BUTTON_LEFT) setSimulSelection(board, (selected_square / 3 * 3) + ((selected_square + 2) % 3));
+    if (state & changed & BUTTON_UP) setSimulSelection(board, (selected_square + 6) % 9);
+    if (state & changed & BUTTON_DOWN) setSimulSelection(board, (selected_square + 3) % 9);
+    if ((state & changed & BUTTON_A) && !simul_cpu_pending[board] && (simul_boards[board].current_player == CROSS) && !isDmaScheduled()) takeSimulSquare(board, selected_square);
 }
 
-bool stopLoss(int* squareIndex, enum SQUARE_STATE player)
+void handleSimulResultInput(u16 joy, u16 changed, u16 state)
 {
-    // same logic as takeWin, but from the point of view of the other player
-    return takeWin(squareIndex, player == NOUGHT ? CROSS : NOUGHT);
+    if (state & changed & BUTTON_A) resetSimul();
 }
 
-bool addToWinnableLine(int* squareIndex, enum SQUARE_STATE player)
+
+/////////////////////////////////////////////////////////////////////////////////////
+// puzzles
+/////////////////////////////////////////////////////////////////////////////////////
+
+void startPuzzles()
 {
-    int values[9] = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    // the standard rules, the player is CROSS and the defence is the line stored with the puzzle
+    game_rules = RULES_STANDARD;
+    loadPuzzleProgress();
+    puzzle_symmetry = random() & 7;
+    setBackground();
+    setForeground();
+    if (music_enabled) XGM_startPlay(music_bg);
+    loadPuzzle();
+}
 
-    // calculate the number of winnable lines for each square
-    for (int line_index=0; line_index<8; line_index++)
-    {
-        if ((countTilesOnWinLine(line_index, player) == 1) && (countTilesOnWinLine(line_index, EMPTY) == 2))
-        {
-            for (int i=0; i<3; i++)
-            {
-                if (game_board[winning_lines[line_index][i]] == EMPTY) values[winning_lines[line_index][i]]++;
-            }
-        }
-    }
+void loadPuzzle()
+{
+    current_game_state = PUZZLE_PLAYING;
+    setUserCursorVisibility(VISIBLE);
+
+    // shown in one of the 8 rotations / reflections, so each puzzle plays as 8
+    u32 start = getSubTick();
+    decodePuzzle(puzzle_boards[puzzle_index], puzzle_lines[puzzle_index], puzzle_symmetry, &current_puzzle);
+    setupPuzzleBoard(&current_puzzle, &game_board);
+    KLog_U2("puzzle ", puzzle_index, " set up subticks ", getSubTick() - start);
 
-    // return the square with the largest value
-    *squareIndex = 0;
-    for(int i=1; i<9; i++)
+    for(int i=0; i<9; i++)
     {
-        if (values[i] > values[*squareIndex])
-        {
-            *squareIndex = i;
-        }
+        drawGameBoardSquare(i, EMPTY);
+        if (game_board.squares[i] != EMPTY) drawGameBoardSquare(i, game_board.squares[i]);
     }
 
-    // return TRUE if the maximum square had at least 1 winnable line
-    return (values[*squareIndex] > 0);
+    drawPuzzleInfo("         ");
+    setSelectedSquare(4);
 }
 
-bool blockLoseableLine(int* squareIndex, enum SQUARE_STATE player)
+void drawPuzzleInfo(const char* status)
 {
-    // same logic as addToWinnableLine, but from the point of view of the other player
-    return addToWinnableLine(squareIndex, player == NOUGHT ? CROSS : NOUGHT);
+    char s[8];
+
+    // in place of the scores - which puzzle, how many moves it takes, how it went
+    VDP_drawText("PUZZLE", 30, 9);
+    intToStr(puzzle_index + 1, s, 3);
+    VDP_drawText(s, 30, 10);
+    VDP_drawText("/", 33, 10);
+    intToStr(PUZZLE_COUNT, s, 3);
+    VDP_drawText(s, 34, 10);
+
+    VDP_drawText("WIN IN", 30, 12);
+    intToStr(current_puzzle.win_in, s, 1);
+    VDP_drawText(s, 37, 12);
+    VDP_drawText(status, 30, 14);
+
+    VDP_drawText("SOLVED:", 30, 16);
+    intToStr(puzzles_solved, s, 3);
+    VDP_drawText(s, 37, 16);
 }
 
-int cpuTurn()
+void nextPuzzle(u16 index)
 {
-    int squareIdx;
+    puzzle_index = index % PUZZLE_COUNT;
+    puzzle_symmetry = random() & 7;
+    savePuzzleProgress(puzzle_index);
+    loadPuzzle();
+}
+
+void takePuzzleSquare(int squareindex)
+{
+    // check square is available
+    if (game_board.squares[squareindex] != EMPTY) return;
+
+    // the only winning move is the next one of the line, so the answer is a compare - no search
+    u32 start = getSubTick();
+    bool right = checkPuzzleMove(&current_puzzle, squareindex);
+    int reply = right ? puzzleReply(&current_puzzle) : -1;
+    KLog_U2("puzzle answer subticks ", getSubTick() - start, " right ", right);
+
+    placePiece(&game_board, squareindex);
+    drawGameBoardSquare(squareindex, CROSS);
+
+    if (!right)
+    {
+        // A plays it again from the start
+        current_game_state = PUZZLE_RESULT;
+        setUserCursorVisibility(HIDDEN);
+        drawPuzzleInfo("TRY AGAIN");
+        return;
+    }
 
-    if (game_opponent == CPU_EASY)
+    // the line is played out - that move made the line
+    if (reply < 0)
     {
-        // take a win 9% of the time
-        if (randTest(90) && (takeWin(&squareIdx, current_player))) return squareIdx;
-        // Stop the other player from winning 75% of the time
-        if (randTest(75) && (stopLoss(&squareIdx, current_player))) return squareIdx;
-        // Add to an available winnable line 75% of the time
-        if (randTest(75) && (addToWinnableLine(&squareIdx, current_player))) return squareIdx;
+        puzzles_solved++;
+        current_game_state = PUZZLE_RESULT;
+        setUserCursorVisibility(HIDDEN);
+        drawPuzzleInfo("SOLVED!  ");
+        savePuzzleProgress((puzzle_index + 1) % PUZZLE_COUNT);
+        return;
     }
 
-    if (game_opponent == CPU_MEDIUM)
+    // the defence answers at once
+    nextPlayer(&game_board);
+    placePiece(&game_board, reply);
+    drawGameBoardSquare(reply, NOUGHT);
+    nextPlayer(&game_board);
+}
+
+void handlePuzzleInput(u16 joy, u16 changed, u16 state)
+{
+    // pause (any pad)
+    if (state & changed & BUTTON_START)
     {
-        // 50% of the time - take center square if available (gives the player a good chance)
-        if ((moves_remaining > 7) && (game_board[CENTER_MIDDLE] == EMPTY) && randTest(50)) return CENTER_MIDDLE;
-        // just aggressively try to build winning lines
-        if (takeWin(&squareIdx, current_player)) return squareIdx;
-        if (stopLoss(&squareIdx, current_player)) return squareIdx;
-        if (addToWinnableLine(&squareIdx, current_player)) return squareIdx;
-        if (blockLoseableLine(&squareIdx, current_player)) return squareIdx;
+        startPauseMenu();
+        return;
     }
 
-    if (game_opponent == CPU_HARD)
+    if (joy != JOY_1) return;
+
+    // C skips the puzzle, B skips to the first that takes more moves (round to the start after the last)
+    if (state & changed & BUTTON_C)
     {
-        // take win if available
-        if (takeWin(&squareIdx, current_player)) return squareIdx;
-        
-        // Block the player from winning if they can
-        if (stopLoss(&squareIdx, current_player)) return squareIdx;
+        nextPuzzle(puzzle_index + 1);
+        return;
+    }
+    if (state & changed & BUTTON_B)
+    {
+        nextPuzzle(puzzle_first[current_puzzle.win_in]);
+        return;
+    }
 
-        // first move - take a corner
-        if (moves_remaining == 9) return BOTTOM_RIGHT;
+    if (state & changed & BUTTON_RIGHT) setSelectedSquare((selected_square / 3 * 3) + ((selected_square + 1) % 3));
+    if (state & changed & BUTTON_LEFT) setSelectedSquare((selected_square / 3 * 3) + ((selected_square + 2) % 3));
+    if (state & changed & BUTTON_UP) setSelectedSquare((selected_square + 6) % 9);
+    if (state & changed & BUTTON_DOWN) setSelectedSquare((selected_square + 3) % 9);
+    if (state & changed & BUTTON_A) takePuzzleSquare(selected_square);
+}
 
-        // if opponents first move was to a side sqaure
-        if ((moves_remaining == 7) && isSide(moves_history[1])) return CENTER_MIDDLE;
-        if ((moves_remaining == 5) && isSide(moves_history[1])) return (game_board[CENTER_RIGHT] == EMPTY) ? TOP_RIGHT : BOTTOM_LEFT;
+void handlePuzzleResultInput(u16 joy, u16 changed, u16 state)
+{
+    if (!(state & changed & BUTTON_A)) return;
 
-        // if opponents first move was to an adjacent corner
-        if ((moves_remaining == 7) && isAdjacentCorner(moves_history[1], moves_history[0])) return (game_board[TOP_RIGHT] == EMPTY) ? TOP_RIGHT : BOTTOM_LEFT;
-        if ((moves_remaining == 5) && isAdjacentCorner(moves_history[1], moves_history[0])) return TOP_LEFT;
+    // on to the next once solved, the same one again (as it was shown) if not
+    if (current_puzzle.step >= current_puzzle.length) nextPuzzle(puzzle_index + 1);
+    else loadPuzzle();
+}
 
-        // if opponents first move was to the opposite corner
-        if ((moves_remaining == 7) && (moves_history[1] == TOP_LEFT)) return TOP_RIGHT;
-        if ((moves_remaining == 5) && (moves_history[1] == TOP_LEFT)) return BOTTOM_LEFT;
 
-        // if opponents first move was to the center square
-        if ((moves_remaining == 7) && (moves_history[1] == CENTER_MIDDLE)) return TOP_LEFT;
-        if ((moves_remaining == 5) && (moves_history[1] == CENTER_MIDDLE) && isCorner(moves_history[3])) return (game_board[TOP_RIGHT] == EMPTY) ? TOP_RIGHT : TOP_LEFT;
+/////////////////////////////////////////////////////////////////////////////////////
+// benchmark
+/////////////////////////////////////////////////////////////////////////////////////
 
-        // if cpu goes second
-        if (moves_remaining % 2 == 0)
-        {
-            // Player started on a corner
-            if (isCorner(moves_history[0]))
-            {
-                if (moves_remaining == 8) return CENTER_MIDDLE;
-                if ((moves_remaining == 6) && isOppositeCorner(moves_history[2], moves_history[0])) return BOTTOM_MIDDLE;
-            }
-
-            // Players started on a side
-            if (isSide(moves_history[0]))
-            {
-                if (moves_remaining == 8) return CENTER_MIDDLE;
-            }
-        }
-        
-        // Tty to take the move that best restricts the opponent
-        if (blockLoseableLine(&squareIdx, current_player)) return squareIdx;
-        if (addToWinnableLine(&squareIdx, current_player)) return squareIdx;
+void startBenchmark()
+{
+    current_game_state = BENCHMARK;
+    bench_saved_board = game_board;
+    bench_saved_opponent = game_opponent;
+    bench_saved_rules = game_rules;
+    game_rules = RULES_STANDARD;
+    bench_row = 0;
+    bench_position = 0;
+    for(int r=0; r<BENCH_ROWS; r++) clearBenchResult(&bench_results[r]);
+
+    // what it costs to time nothing, taken off every sample
+    bench_overhead = 0xFFFFFFFF;
+    for(int i=0; i<8; i++)
+    {
+        u32 cycles = timeBenchRow(BENCH_ROWS);
+        if (cycles < bench_overhead) bench_overhead = cycles;
     }
 
-    // any old square will do
-    return randomMove();
+    VDP_drawText("BENCHMARK", 29, 2);
+    bench_start_frame = vtimer;
 }
 
-bool testWin()
+void updateBenchmark()
 {
-    // not enough moves for a winning line
-    if (moves_remaining > 4) return FALSE;
+    if ((current_game_state != BENCHMARK) || (transition_step != TRANSITION_IDLE)) return;
 
-    // check each winning line
-    for(int i=0; i<8; i++)
+    // squares are only drawn once the last one is uploaded, so the scheduler never backs up
+    if ((bench_row == BENCH_SCHEDULE_SQUARE) && isDmaScheduled()) return;
+
+    VDP_clearText(29, 4, 11);
+    VDP_drawText(bench_row_names[bench_row], 29, 4);
+
+    setupBenchPosition(bench_position, &game_board);
+    if (bench_row < BENCH_TEST_WIN) game_opponent = bench_row - BENCH_CPU_TURN;
+    u32 cycles = timeBenchRow(bench_row);
+    addBenchSample(&bench_results[bench_row], cycles > bench_overhead ? cycles - bench_overhead : 0);
+
+    if (++bench_position < BENCH_POSITIONS) return;
+    bench_position = 0;
+    if (++bench_row == BENCH_ROWS) finishBenchmark();
+}
+
+u32 timeBenchRow(int row)
+{
+    // from the first line of the active display - the next vblank interrupt is 224 lines (over 100000 cycles) away
+    while (!GET_VDPSTATUS(VDP_VBLANK_FLAG));
+    while (GET_VDPSTATUS(VDP_VBLANK_FLAG));
+
+    u32 frame = vtimer;
+    u32 start_subtick = getSubTick();
+    u16 start = GET_HVCOUNTER;
+
+    if (row < BENCH_TEST_WIN) cpuTurn(&game_board);
+    if (row == BENCH_TEST_WIN) testWin(&game_board);
+    // only the call that schedules the upload - the dma itself runs in a later vblank and is not timed
+    if (row == BENCH_SCHEDULE_SQUARE) drawGameBoardSquare(bench_position % 9, game_board.squares[bench_position % 9]);
+
+    u16 end = GET_HVCOUNTER;
+
+    // ran into the vblank - the subtick timer (~100 cycles) instead
+    if (GET_VDPSTATUS(VDP_VBLANK_FLAG) || (vtimer != frame))
+    {
+        return (getSubTick() - start_subtick) * ((IS_PALSYSTEM ? 7600489 : 7670453) / SUBTICKPERSECOND);
+    }
+    return hvCycles(start, end);
+}
+
+void finishBenchmark()
+{
+    bench_frames = vtimer - bench_start_frame;
+    stopPieceAnims();
+    saveBenchmark();
+
+    game_board = bench_saved_board;
+    game_opponent = bench_saved_opponent;
+    game_rules = bench_saved_rules;
+
+    for(int r=0; r<BENCH_ROWS; r++)
+    {
+        KLog_U3(bench_row_names[r], bench_results[r].min, " avg ", benchAverage(&bench_results[r]), " max ", bench_results[r].max);
+    }
+    startTransition(BENCHMARK_RESULT, FALSE);
+}
+
+void saveBenchmark()
+{
+    SRAM_enable();
+    SRAM_writeWord(BENCH_SRAM + 4, BENCH_VERSION);
+    SRAM_writeWord(BENCH_SRAM + 6, BENCH_ROWS);
+    SRAM_writeWord(BENCH_SRAM + 8, BENCH_POSITIONS);
+    SRAM_writeWord(BENCH_SRAM + 10, IS_PALSYSTEM ? BENCH_PAL : 0);
+    SRAM_writeLong(BENCH_SRAM + 12, bench_frames);
+    SRAM_writeLong(BENCH_SRAM + 16, bench_overhead);
+
+    for(int r=0; r<BENCH_ROWS; r++)
+    {
+        BenchResult* result = &bench_results[r];
+        SRAM_writeLong(BENCH_SRAM + BENCH_SRAM_ROWS + (r * 12) + 0, result->min);
+        SRAM_writeLong(BENCH_SRAM + BENCH_SRAM_ROWS + (r * 12) + 4, benchAverage(result));
+        SRAM_writeLong(BENCH_SRAM + BENCH_SRAM_ROWS + (r * 12) + 8, result->max);
+        for(int p=0; p<BENCH_POSITIONS; p++) SRAM_writeLong(BENCH_SRAM + BENCH_SRAM_SAMPLES + ((r * BENCH_POSITIONS + p) * 4), result->cycles[p]);
+    }
+
+    // the magic goes in last, so a record cut short is not read
+    SRAM_writeLong(BENCH_SRAM, BENCH_MAGIC);
+    SRAM_disable();
+}
+
+void showBenchmarkResult()
+{
+    char s[12];
+
+    current_game_state = BENCHMARK_RESULT;
+
+    VDP_drawText("BENCHMARK", 1, 1);
+    VDP_drawText(IS_PALSYSTEM ? "PAL" : "NTSC", 12, 1);
+    intToStr(bench_frames, s, 6);
+    VDP_drawText(s, 18, 1);
+    VDP_drawText("FRAMES", 25, 1);
+
+    // estimated 68000 cycles per call over the positions, from the hv counter
+    VDP_drawText("CYCLES", 1, 4);
+    VDP_drawText("MIN", 15, 4);
+    VDP_drawText("AVG", 23, 4);
+    VDP_drawText("MAX", 31, 4);
+    for(int r=0; r<BENCH_ROWS; r++)
+    {
+        VDP_drawText(bench_row_names[r], 1, 6 + r);
+        intToStr(bench_results[r].min, s, 1);
+        VDP_drawText(s, 15, 6 + r);
+        intToStr(benchAverage(&bench_results[r]), s, 1);
+        VDP_drawText(s, 23, 6 + r);
+        intToStr(bench_results[r].max, s, 1);
+        VDP_drawText(s, 31, 6 + r);
+    }
+
+    VDP_drawText("TIMING OVERHEAD", 1, 14);
+    intToStr(bench_overhead, s, 1);
+    VDP_drawText(s, 23, 14);
+    VDP_drawText("POSITIONS", 1, 15);
+    intToStr(BENCH_POSITIONS, s, 1);
+    VDP_drawText(s, 23, 15);
+
+    VDP_drawText("SAVED TO SRAM", 1, 18);
+    VDP_drawText("PRESS A", 1, 20);
+}
+
+void handleBenchmarkResultInput(u16 joy, u16 changed, u16 state)
+{
+    if (state & changed & (BUTTON_A | BUTTON_C | BUTTON_START)) startTransition(MAIN_MENU, FALSE);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// game result screen
+/////////////////////////////////////////////////////////////////////////////////////
+
+void showGameResult()
+{
+    current_game_state = GAME_RESULT;
+    // hide the cursor sprites
+    setUserCursorVisibility(HIDDEN); 
+    // Save scores
+    saveScores(game_opponent);
+    // Update the scores
+    drawGameScores();
+
+    if (link_play)
     {
-        if (countTilesOnWinLine(i, current_player) == 3) return TRUE;
+        u32 bytes = link_session.bytes_sent + link_session.bytes_received;
+        KLog_U3("link rtt frames ", link_session.rtt, " max ", link_session.rtt_max, " bytes per move ", link_moves ? bytes / link_moves : 0);
     }
+}
+
+void handleGameResultInput(u16 joy, u16 changed, u16 state)
+{
+    // in link play the next game starts from the lockstep (updateLink)
+    if (link_play) return;
 
-    // no win found
-    return FALSE;
+    if (state & changed & BUTTON_A) 
+    {
+        current_game_state = GAME_PLAYING;
+        resetGame();
+    }
 }
 
 
@@ -1039,6 +2022,11 @@ int main()
     loadTiles();
     loadPallete();
     loadSprites();
+    initPlaneBuffers();
+    resetDifficultyLimits();
+
+    // show composed screens from vblank
+    SYS_setVBlankCallback(flipPlaneA);
 
     // setup background scrolling
     VDP_setScrollingMode(HSCROLL_PLANE, VSCROLL_PLANE);
@@ -1053,12 +2041,35 @@ int main()
     // enter game loop
     while(TRUE)
     {
+        // timed calls go first, while still in the vblank
+        updateBenchmark();
+
+        // build / show the next screen
+        updateTransition();
+
         // update the scrolling background
         scrollBackground();
 
+        // cpu replies on the simul boards
+        updateSimul();
+
+        // link play - exchange pads, run the lockstep
+        updateLink();
+
+        // the analysis overlay, once the squares under it are uploaded
+        updateAnalysis();
+
+        // numbers of numerical games
+        updateNumbers();
+
         // Update all sprite animations
         SPR_update();
 
+        // move scheduled uploads to the dma queue, then stream piece animations into what is left
+        updateDmaScheduler();
+        updatePieceAnims();
+        endDmaFrame();
+
         // Wait for frame to be fully drawn
         SYS_doVBlankProcess();
     }
@@ -0,0 +1,179 @@
+/**
+ * Tic-Tac-Toe
+ * Draw-in animation of the pieces
+ *
+ * The piece tiles are loaded once at startup, so the animation only streams the
+ * tilemap: each frame the cells whose reveal frame has come are queued as row runs
+ * of nametable entries into whatever the DMA scheduler has left of this frame's
+ * budget and of SGDK's queue; cells that do not fit wait for the next frame, so
+ * the queue never outgrows vblank even when the cpu moves in the same frame as
+ * the player.
+ **/
+#include <genesis.h>
+#include <piece_anim.h>
+#include <dma_scheduler.h>
+
+// the cross is drawn as two strokes, top left to bottom right then top right to bottom left
+const u8 cross_reveal[64] = {
+     0,  0,  0,  0,  0,  0,  8,  8,
+     1,  1,  1,  0,  0,  9,  9,  9,
+     0,  2,  2,  2, 10, 10, 10,  0,
+     0,  0,  3,  3,  3, 11,  0,  0,
+     0,  0, 12,  4,  4,  4,  0,  0,
+     0, 13, 13, 13,  5,  5,  5,  0,
+    14, 14, 14,  0,  0,  6,  6,  6,
+    15, 15,  0,  0,  0,  0,  7,  7,
+};
+
+// the nought is drawn clockwise from the top
+const u8 nought_reveal[64] = {
+    14, 14, 14, 15,  0,  1,  1,  2,
+    13, 14, 14, 15,  0,  1,  2,  2,
+    13, 13, 14, 15,  0,  2,  2,  2,
+    12, 12, 12,  0,  0,  3,  3,  3,
+    11, 11, 11,  0,  0,  4,  4,  4,
+    10, 10, 10,  8,  7,  6,  5,  5,
+    10, 10,  9,  8,  7,  6,  6,  5,
+    10,  9,  9,  8,  7,  6,  6,  6,
+};
+
+#define MAX_PIECE_ANIMS 9
+
+typedef struct
+{
+    bool active;
+    u16 x;
+    u16 y;
+    const Image* image;
+    u16 basetile;
+    const u8* reveal;
+    u8 frame;
+    u8 shown[8];        // bit per cell already queued, per row
+} PieceAnim;
+
+PieceAnim piece_anims[MAX_PIECE_ANIMS];
+
+// instrumentation, logged when the last animation finishes
+u16 anim_frames;
+u16 anim_deferred_frames;
+
+
+void startPieceAnim(u16 x, u16 y, const Image* image, u16 basetile, const u8* reveal)
+{
+    PieceAnim* anim = NULL;
+
+    stopPieceAnim(x, y);
+    for (int i=0; i<MAX_PIECE_ANIMS; i++)
+    {
+        if (!piece_anims[i].active)
+        {
+            anim = &piece_anims[i];
+            break;
+        }
+    }
+
+    // all slots busy - just draw it
+    if (anim == NULL)
+    {
+        VDP_setTileMapEx(BG_A, image->tilemap, basetile, x, y, 0, 0, 8, 8, DMA_QUEUE);
+        return;
+    }
+
+    anim->active = TRUE;
+    anim->x = x;
+    anim->y = y;
+    anim->image = image;
+    anim->basetile = basetile;
+    anim->reveal = reveal;
+    anim->frame = 0;
+    for (int row=0; row<8; row++) anim->shown[row] = 0;
+}
+
+void stopPieceAnim(u16 x, u16 y)
+{
+    for (int i=0; i<MAX_PIECE_ANIMS; i++)
+    {
+        if (piece_anims[i].active && (piece_anims[i].x == x) && (piece_anims[i].y == y)) piece_anims[i].active = FALSE;
+    }
+}
+
+void stopPieceAnims()
+{
+    for (int i=0; i<MAX_PIECE_ANIMS; i++) piece_anims[i].active = FALSE;
+}
+
+bool isPieceAnimRunning()
+{
+    for (int i=0; i<MAX_PIECE_ANIMS; i++)
+    {
+        if (piece_anims[i].active) return TRUE;
+    }
+    return FALSE;
+}
+
+// queue the due cells of one animation, returns FALSE when the budget (bytes, and queue entries - one per run) ran out
+bool streamPieceAnim(PieceAnim* anim, u16* budget, u16* entries)
+{
+    bool done = TRUE;
+
+    for (u16 row=0; row<8; row++)
+    {
+        const u8* reveal = &anim->reveal[row * 8];
+        u16 col = 0;
+
+        while (col < 8)
+        {
+            // find the next run of due cells not yet queued
+            if ((anim->shown[row] & (1 << col)) || (reveal[col] > anim->frame))
+            {
+                if (reveal[col] > anim->frame) done = FALSE;
+                col++;
+                continue;
+            }
+
+            u16 len = 1;
+            while ((col + len < 8) && !(anim->shown[row] & (1 << (col + len))) && (reveal[col + len] <= anim->frame)) len++;
+
+            // 2 bytes per nametable entry
+            if ((len * 2 > *budget) || (*entries == 0)) return FALSE;
+            *budget -= len * 2;
+            (*entries)--;
+
+            VDP_setTileMapEx(BG_A, anim->image->tilemap, anim->basetile, anim->x + col, anim->y + row, col, row, len, 1, DMA_QUEUE);
+            anim->shown[row] |= ((1 << len) - 1) << col;
+            col += len;
+        }
+    }
+
+    if (done) anim->active = FALSE;
+    return TRUE;
+}
+
+void updatePieceAnims()
+{
+    // a piece never lands before the square under it has been uploaded
+    if (!isPieceAnimRunning() || isDmaScheduled()) return;
+
+    u16 budget = dmaBytesAvailable();
+    u16 entries = dmaEntriesAvailable();
+    bool deferred = FALSE;
+
+    for (int i=0; i<MAX_PIECE_ANIMS; i++)
+    {
+        PieceAnim* anim = &piece_anims[i];
+        if (!anim->active) continue;
+
+        if (!streamPieceAnim(anim, &budget, &entries)) deferred = TRUE;
+        if (anim->frame < 255) anim->frame++;
+    }
+
+    anim_frames++;
+    if (deferred) anim_deferred_frames++;
+
+    if (!isPieceAnimRunning())
+    {
+        KLog_U2("piece anim frames ", anim_frames, " held back by the dma budget ", anim_deferred_frames);
+        anim_frames = 0;
+        anim_deferred_frames = 0;
+    }
+}
@@ -0,0 +1,78 @@
+/**
+ * Tic-Tac-Toe
+ * "Win in N" puzzles - generated by tools/puzzle_gen.c, do not edit
+ **/
+#include <genesis.h>
+#include <puzzle_tables.h>
+
+const u16 puzzle_first[PUZZLE_MAX_WIN_IN + 1] = { 0, 264, 298, 304, PUZZLE_COUNT };
+
+const u32 puzzle_boards[PUZZLE_COUNT] = {
+    0xFF225800, 0xFF216200, 0xFF119200, 0xFF314A00, 0xFF311A00, 0xFF305A00, 0xFF024600, 0xFF212600,
+    0xFF206600, 0xFF216600, 0xFF021600, 0xFF109600, 0xFF119600, 0xFF025600, 0xFF224900, 0xFF221900,
+    0xFF225900, 0xFF722500, 0xFF80A500, 0xFF414880, 0xFF411880, 0xFF012480, 0xFF006480, 0xFF016480,
+    0xFF119680, 0xFF025680, 0xFF016980, 0xFF002580, 0xFF012580, 0xFF01A580, 0xFF006580, 0xFF026580,
+    0xFF628440, 0xFF722440, 0xFF020640, 0xFF108640, 0xFF118640, 0xFF024640, 0xFF212640, 0xFF416020,
+    0xFF525020, 0xFF805820, 0xFF406420, 0xFF416420, 0xFF119620, 0xFF025620, 0xFF521120, 0xFF525120,
+    0xFF801920, 0xFF805920, 0xFF6146A0, 0xFF0161A0, 0xFF5251A0, 0xFF8059A0, 0xFF0125A0, 0xFF0065A0,
+    0xFF0165A0, 0xFF524060, 0xFF412060, 0xFF406060, 0xFF416060, 0xFF521060, 0xFF525060, 0xFF804860,
+    0xFF416860, 0xFF801860, 0xFF805860, 0xFF402460, 0xFF412460, 0xFF41A460, 0xFF406460, 0xFF426460,
+    0xFF610260, 0xFF604260, 0xFF614260, 0xFF119260, 0xFF614A60, 0xFF805A60, 0xFF610660, 0xFF604660,
+    0xFF021660, 0xFF109660, 0xFF119660, 0xFF025660, 0xFF520160, 0xFF524160, 0xFF526160, 0xFF521160,
+    0xFF529160, 0xFF804960, 0xFF806960, 0xFF801960, 0xFF809960, 0xFF021210, 0xFF109210, 0xFF119210,
+    0xFF025210, 0xFF305A10, 0xFF012090, 0xFF006090, 0xFF016090, 0xFF410890, 0xFF404890, 0xFF414890,
+    0xFF401890, 0xFF411890, 0xFF419890, 0xFF405890, 0xFF425890, 0xFF006490, 0xFF026490, 0xFF510290,
+    0xFF504290, 0xFF514290, 0xFF511290, 0xFF505290, 0xFF024690, 0xFF006690, 0xFF021690, 0xFF109690,
+    0xFF025690, 0xFF012190, 0xFF01A190, 0xFF006190, 0xFF026190, 0xFF012990, 0xFF006990, 0xFF016990,
+    0xFF628590, 0xFF026590, 0xFF628050, 0xFF722050, 0xFF628450, 0xFF722450, 0xFF80A450, 0xFF118250,
+    0xFF024250, 0xFF11A250, 0xFF026250, 0xFF021250, 0xFF118A50, 0xFF024A50, 0xFF021A50, 0xFF109A50,
+    0xFF119A50, 0xFF025A50, 0xFF108650, 0xFF026650, 0xFF628150, 0xFF722150, 0xFF628950, 0xFF722950,
+    0xFF80A950, 0xFF016488, 0xFF419488, 0xFF711688, 0xFF012588, 0xFF006588, 0xFF016588, 0xFF408448,
+    0xFF418448, 0xFF41A448, 0xFF024648, 0xFF216648, 0xFF0114A8, 0xFF0054A8, 0xFF0111A8, 0xFF0165A8,
+    0xFF0115A8, 0xFF0195A8, 0xFF0055A8, 0xFF0255A8, 0xFF014068, 0xFF011068, 0xFF014868, 0xFF011868,
+    0xFF004468, 0xFF024468, 0xFF021468, 0xFF025468, 0xFF005668, 0xFF025668, 0xFF018168, 0xFF012168,
+    0xFF016168, 0xFF019168, 0xFF014968, 0xFF016968, 0xFF011968, 0xFF019968, 0xFF419098, 0xFF405898,
+    0xFF025698, 0xFF418058, 0xFF41A058, 0xFF429058, 0xFF418858, 0xFF419858, 0xFF722458, 0xFF429458,
+    0xFF024258, 0xFF712258, 0xFF025258, 0xFF711A58, 0xFF025A58, 0xFF024658, 0xFF026658, 0xFF722158,
+    0xFF722444, 0xFF21A644, 0xFF412064, 0xFF41A064, 0xFF521064, 0xFF529064, 0xFF416864, 0xFF426464,
+    0xFF021664, 0xFF029664, 0xFF529164, 0xFF029254, 0xFF029A54, 0xFF111022, 0xFF111422, 0xFF119422,
+    0xFF111622, 0xFF111122, 0xFF119122, 0xFF111922, 0xFF121522, 0xFF119522, 0xFF125522, 0xFF1114A2,
+    0xFF1115A2, 0xFF1195A2, 0xFF1255A2, 0xFF119462, 0xFF111662, 0xFF119662, 0xFF421012, 0xFF425012,
+    0xFF425812, 0xFF119212, 0xFF425092, 0xFF411892, 0xFF421492, 0xFF425492, 0xFF511292, 0xFF426052,
+    0xFF425852, 0xFF426452, 0xFF429452, 0xFF119252, 0xFF119A52, 0xFF42549A, 0xFF41905A, 0xFF41985A,
+    0xFF42585A, 0xFF42645A, 0xFF42945A, 0xFF71125A, 0xFF711A5A, 0xFF426466, 0xFF419891, 0xFF419899,
+    0x10469400, 0x70660580, 0x80648580, 0x20466440, 0x40159020, 0x41061420, 0x40149420, 0x40159420,
+    0x41065420, 0x50845220, 0x31052120, 0x406540A0, 0x406544A0, 0x401594A0, 0x410654A0, 0x610501A0,
+    0x610505A0, 0x610585A0, 0x60460460, 0x60464460, 0x81041660, 0x10469010, 0x30465810, 0x50461090,
+    0x50465090, 0x10469490, 0x80648190, 0x62044488, 0x42065488, 0x62044588, 0x62064588, 0x20466448,
+    0x50465098, 0x31459812, 0x42881800, 0x42885800, 0x40298480, 0x05885020, 0x058850A0, 0x46888490
+};
+
+const u16 puzzle_lines[PUZZLE_COUNT] = {
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF,
+    0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFF30, 0xFF30,
+    0xFF61, 0xFF41, 0xFF41, 0xFF10
+};
@@ -0,0 +1,71 @@
+/**
+ * Tic-Tac-Toe
+ * "Win in N" puzzles
+ *
+ * Each puzzle is stored with its whole solution: there is only one winning move
+ * at every step, and the defence always makes the reply that holds out longest,
+ * so checking an answer is comparing it with the next move of the line - the
+ * console never searches. tools/puzzle_gen.c finds them and checks every line.
+ **/
+#include <genesis.h>
+#include <game_logic.h>
+#include <puzzles.h>
+
+void decodePuzzle(u32 board, u16 line, int symmetry, Puzzle* puzzle)
+{
+    u8 shown[9];
+    LOGIC_COST(120);
+
+    // square i on screen is square board_symmetries[symmetry][i] of the stored puzzle
+    for (int i=0; i<9; i++)
+    {
+        LOGIC_COST(70);
+        u8 square = board_symmetries[symmetry][i];
+        puzzle->squares[i] = (board >> (square * 2)) & 3;
+        shown[square] = i;
+    }
+
+    puzzle->win_in = ((board >> PUZZLE_WIN_IN_SHIFT) & 3) + 1;
+    puzzle->length = puzzle->win_in * 2 - 1;
+    puzzle->step = 0;
+
+    u32 moves = (board >> PUZZLE_MOVES_SHIFT) | ((u32)line << 12);
+    for (int m=0; m<puzzle->length; m++)
+    {
+        LOGIC_COST(50);
+        puzzle->moves[m] = shown[moves & 15];
+        moves >>= 4;
+    }
+}
+
+void setupPuzzleBoard(const Puzzle* puzzle, GameBoard* board)
+{
+    LOGIC_COST(60);
+    board->current_player = CROSS;
+    board->moves_remaining = 9;
+
+    // only the last move matters to testWin, the order of the rest is made up
+    for (int i=0; i<9; i++)
+    {
+        LOGIC_COST(40);
+        board->squares[i] = puzzle->squares[i];
+        if (puzzle->squares[i] == EMPTY) continue;
+        board->moves_history[9 - board->moves_remaining] = i;
+        board->moves_remaining--;
+    }
+}
+
+bool checkPuzzleMove(Puzzle* puzzle, int square)
+{
+    LOGIC_COST(60);
+    if ((puzzle->step >= puzzle->length) || (puzzle->moves[puzzle->step] != square)) return FALSE;
+    puzzle->step++;
+    return TRUE;
+}
+
+int puzzleReply(Puzzle* puzzle)
+{
+    LOGIC_COST(50);
+    if (puzzle->step >= puzzle->length) return -1;
+    return puzzle->moves[puzzle->step++];
+}
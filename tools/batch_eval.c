@@ -0,0 +1,278 @@
+/**
+ * Tic-Tac-Toe
+ * Host-only batch position evaluator (scalar, SSE2 and AVX2 paths)
+ *
+ * The SIMD paths narrow the square masks to one board per 8 bit lane (16 boards
+ * per SSE2 instruction, 32 per AVX2 instruction), split each board into per-square
+ * 0/1 planes and then sum the planes along every winning line.
+ **/
+#include <pthread.h>
+#include <genesis.h>
+#include <game_logic.h>
+#include "batch_eval.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+static u16 line_masks[8];
+static pthread_once_t line_masks_once = PTHREAD_ONCE_INIT;
+
+static void buildLineMasks()
+{
+    for (int line_index=0; line_index<8; line_index++)
+    {
+        for (int i=0; i<3; i++) line_masks[line_index] |= 1 << winning_lines[line_index][i];
+    }
+}
+
+// callers may be worker threads - the masks are built exactly once, and visible to all of them after
+static void initLineMasks()
+{
+    pthread_once(&line_masks_once, buildLineMasks);
+}
+
+void packBoard(const u8* board, u16* crosses, u16* noughts)
+{
+    *crosses = 0;
+    *noughts = 0;
+    for (int i=0; i<9; i++)
+    {
+        if (board[i] == CROSS) *crosses |= 1 << i;
+        if (board[i] == NOUGHT) *noughts |= 1 << i;
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// scalar fallback
+/////////////////////////////////////////////////////////////////////////////////////
+
+void batchEvaluateScalar(const BoardBatch* batch, enum SQUARE_STATE player, LineCounts* out)
+{
+    initLineMasks();
+
+    for (u32 n=0; n<batch->count; n++)
+    {
+        u16 own = player == CROSS ? batch->crosses[n] : batch->noughts[n];
+        u16 empty = ~(batch->crosses[n] | batch->noughts[n]) & 0x1FF;
+        u8 wins = 0, threats = 0, winnable = 0;
+
+        for (int line_index=0; line_index<8; line_index++)
+        {
+            int owned = __builtin_popcount(own & line_masks[line_index]);
+            int empties = __builtin_popcount(empty & line_masks[line_index]);
+            if (owned == 3) wins++;
+            if ((owned == 2) && (empties == 1)) threats++;
+            if ((owned == 1) && (empties == 2)) winnable++;
+        }
+
+        out->wins[n] = wins;
+        out->threats[n] = threats;
+        out->winnable[n] = winnable;
+    }
+}
+
+
+#if defined(__x86_64__)
+
+/////////////////////////////////////////////////////////////////////////////////////
+// SSE2 - 16 boards per instruction
+/////////////////////////////////////////////////////////////////////////////////////
+
+// squares 0-7 of 16 boards as one byte each, and square 8 the same way
+static inline void loadSquareBytes(const u16* masks, __m128i* low, __m128i* high)
+{
+    const __m128i byte = _mm_set1_epi16(0xFF);
+    __m128i a = _mm_loadu_si128((const __m128i*)masks);
+    __m128i b = _mm_loadu_si128((const __m128i*)(masks + 8));
+    *low = _mm_packus_epi16(_mm_and_si128(a, byte), _mm_and_si128(b, byte));
+    *high = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+}
+
+void batchEvaluateSSE2(const BoardBatch* batch, enum SQUARE_STATE player, LineCounts* out)
+{
+    const u16* own_masks = player == CROSS ? batch->crosses : batch->noughts;
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i two = _mm_set1_epi8(2);
+    const __m128i three = _mm_set1_epi8(3);
+    const __m128i all = _mm_set1_epi8(-1);
+    u32 n = 0;
+
+    for (; n + 16 <= batch->count; n += 16)
+    {
+        __m128i x_low, x_high, o_low, o_high, own_low, own_high;
+        loadSquareBytes(batch->crosses + n, &x_low, &x_high);
+        loadSquareBytes(batch->noughts + n, &o_low, &o_high);
+        loadSquareBytes(own_masks + n, &own_low, &own_high);
+        __m128i empty_low = _mm_andnot_si128(_mm_or_si128(x_low, o_low), all);
+        __m128i empty_high = _mm_andnot_si128(_mm_or_si128(x_high, o_high), all);
+        __m128i own_sq[9], empty_sq[9];
+        __m128i wins = _mm_setzero_si128(), threats = _mm_setzero_si128(), winnable = _mm_setzero_si128();
+
+        // split into 0/1 planes, one per square - there is no byte shift, but the 16 bit one
+        // leaves bit 0 of each byte right
+        for (int i=0; i<8; i++)
+        {
+            __m128i shift = _mm_cvtsi32_si128(i);
+            own_sq[i] = _mm_and_si128(_mm_srl_epi16(own_low, shift), one);
+            empty_sq[i] = _mm_and_si128(_mm_srl_epi16(empty_low, shift), one);
+        }
+        own_sq[8] = _mm_and_si128(own_high, one);
+        empty_sq[8] = _mm_and_si128(empty_high, one);
+
+        for (int line_index=0; line_index<8; line_index++)
+        {
+            const u8* line = winning_lines[line_index];
+            __m128i owned = _mm_add_epi8(_mm_add_epi8(own_sq[line[0]], own_sq[line[1]]), own_sq[line[2]]);
+            __m128i empties = _mm_add_epi8(_mm_add_epi8(empty_sq[line[0]], empty_sq[line[1]]), empty_sq[line[2]]);
+            // compares give -1 per matching lane, so subtracting counts them
+            wins = _mm_sub_epi8(wins, _mm_cmpeq_epi8(owned, three));
+            threats = _mm_sub_epi8(threats, _mm_and_si128(_mm_cmpeq_epi8(owned, two), _mm_cmpeq_epi8(empties, one)));
+            winnable = _mm_sub_epi8(winnable, _mm_and_si128(_mm_cmpeq_epi8(owned, one), _mm_cmpeq_epi8(empties, two)));
+        }
+
+        _mm_storeu_si128((__m128i*)(out->wins + n), wins);
+        _mm_storeu_si128((__m128i*)(out->threats + n), threats);
+        _mm_storeu_si128((__m128i*)(out->winnable + n), winnable);
+    }
+
+    // left over boards
+    if (n < batch->count)
+    {
+        BoardBatch tail = { batch->count - n, batch->crosses + n, batch->noughts + n };
+        LineCounts tail_out = { out->wins + n, out->threats + n, out->winnable + n };
+        batchEvaluateScalar(&tail, player, &tail_out);
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// AVX2 - 32 boards per instruction
+/////////////////////////////////////////////////////////////////////////////////////
+
+// as loadSquareBytes - packus works per 128 bit lane, so the boards come out as 0-7, 16-23, 8-15, 24-31
+__attribute__((target("avx2")))
+static inline void loadSquareBytes256(const u16* masks, __m256i* low, __m256i* high)
+{
+    const __m256i byte = _mm256_set1_epi16(0xFF);
+    __m256i a = _mm256_loadu_si256((const __m256i*)masks);
+    __m256i b = _mm256_loadu_si256((const __m256i*)(masks + 16));
+    *low = _mm256_packus_epi16(_mm256_and_si256(a, byte), _mm256_and_si256(b, byte));
+    *high = _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+}
+
+__attribute__((target("avx2")))
+static void storeBoards(u8* dest, __m256i v)
+{
+    // put the quadwords back in board order
+    _mm256_storeu_si256((__m256i*)dest, _mm256_permute4x64_epi64(v, 0xD8));
+}
+
+__attribute__((target("avx2")))
+void batchEvaluateAVX2(const BoardBatch* batch, enum SQUARE_STATE player, LineCounts* out)
+{
+    const u16* own_masks = player == CROSS ? batch->crosses : batch->noughts;
+    const __m256i one = _mm256_set1_epi8(1);
+    const __m256i two = _mm256_set1_epi8(2);
+    const __m256i three = _mm256_set1_epi8(3);
+    const __m256i all = _mm256_set1_epi8(-1);
+    u32 n = 0;
+
+    for (; n + 32 <= batch->count; n += 32)
+    {
+        __m256i x_low, x_high, o_low, o_high, own_low, own_high;
+        loadSquareBytes256(batch->crosses + n, &x_low, &x_high);
+        loadSquareBytes256(batch->noughts + n, &o_low, &o_high);
+        loadSquareBytes256(own_masks + n, &own_low, &own_high);
+        __m256i empty_low = _mm256_andnot_si256(_mm256_or_si256(x_low, o_low), all);
+        __m256i empty_high = _mm256_andnot_si256(_mm256_or_si256(x_high, o_high), all);
+        __m256i own_sq[9], empty_sq[9];
+        __m256i wins = _mm256_setzero_si256(), threats = _mm256_setzero_si256(), winnable = _mm256_setzero_si256();
+
+        for (int i=0; i<8; i++)
+        {
+            __m128i shift = _mm_cvtsi32_si128(i);
+            own_sq[i] = _mm256_and_si256(_mm256_srl_epi16(own_low, shift), one);
+            empty_sq[i] = _mm256_and_si256(_mm256_srl_epi16(empty_low, shift), one);
+        }
+        own_sq[8] = _mm256_and_si256(own_high, one);
+        empty_sq[8] = _mm256_and_si256(empty_high, one);
+
+        for (int line_index=0; line_index<8; line_index++)
+        {
+            const u8* line = winning_lines[line_index];
+            __m256i owned = _mm256_add_epi8(_mm256_add_epi8(own_sq[line[0]], own_sq[line[1]]), own_sq[line[2]]);
+            __m256i empties = _mm256_add_epi8(_mm256_add_epi8(empty_sq[line[0]], empty_sq[line[1]]), empty_sq[line[2]]);
+            wins = _mm256_sub_epi8(wins, _mm256_cmpeq_epi8(owned, three));
+            threats = _mm256_sub_epi8(threats, _mm256_and_si256(_mm256_cmpeq_epi8(owned, two), _mm256_cmpeq_epi8(empties, one)));
+            winnable = _mm256_sub_epi8(winnable, _mm256_and_si256(_mm256_cmpeq_epi8(owned, one), _mm256_cmpeq_epi8(empties, two)));
+        }
+
+        storeBoards(out->wins + n, wins);
+        storeBoards(out->threats + n, threats);
+        storeBoards(out->winnable + n, winnable);
+    }
+
+    // left over boards go through the 16 wide path
+    if (n < batch->count)
+    {
+        BoardBatch tail = { batch->count - n, batch->crosses + n, batch->noughts + n };
+        LineCounts tail_out = { out->wins + n, out->threats + n, out->winnable + n };
+        batchEvaluateSSE2(&tail, player, &tail_out);
+    }
+}
+
+bool batchHasAVX2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? TRUE : FALSE;
+}
+
+#endif
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// runtime dispatch
+/////////////////////////////////////////////////////////////////////////////////////
+
+typedef void (*BatchEvaluateFn)(const BoardBatch* batch, enum SQUARE_STATE player, LineCounts* out);
+
+static BatchEvaluateFn batch_impl;
+static const char* batch_impl_name;
+static pthread_once_t batch_impl_once = PTHREAD_ONCE_INIT;
+
+static void pickImpl()
+{
+    // the SIMD paths read line layout from winning_lines directly, the scalar path needs masks
+    initLineMasks();
+
+    batch_impl = batchEvaluateScalar;
+    batch_impl_name = "scalar";
+#if defined(__x86_64__)
+    batch_impl = batchEvaluateSSE2;
+    batch_impl_name = "sse2";
+    if (batchHasAVX2())
+    {
+        batch_impl = batchEvaluateAVX2;
+        batch_impl_name = "avx2";
+    }
+#endif
+}
+
+static void selectImpl()
+{
+    pthread_once(&batch_impl_once, pickImpl);
+}
+
+void batchEvaluate(const BoardBatch* batch, enum SQUARE_STATE player, LineCounts* out)
+{
+    selectImpl();
+    batch_impl(batch, player, out);
+}
+
+const char* batchEvaluateName()
+{
+    selectImpl();
+    return batch_impl_name;
+}
@@ -0,0 +1,47 @@
+/**
+ * Tic-Tac-Toe
+ * Host-only batch position evaluator
+ *
+ * Boards are packed into structure-of-arrays form: bit i of crosses[n] / noughts[n]
+ * is set when square i of board n holds that piece. For every board the evaluator
+ * counts, for the given player, the winning lines that are:
+ *   wins     - three of player
+ *   threats  - two of player and one empty square (what takeWin looks for)
+ *   winnable - one of player and two empty squares (what addToWinnableLine looks for)
+ **/
+#ifndef _BATCH_EVAL_H_
+#define _BATCH_EVAL_H_
+
+#include <genesis.h>
+#include <game_logic.h>
+
+typedef struct
+{
+    u32 count;
+    const u16* crosses;
+    const u16* noughts;
+} BoardBatch;
+
+typedef struct
+{
+    u8* wins;
+    u8* threats;
+    u8* winnable;
+} LineCounts;
+
+// pack a board's squares into a pair of square masks
+void packBoard(const u8* board, u16* crosses, u16* noughts);
+
+// evaluate a batch with the best implementation the cpu supports - from any number of threads
+void batchEvaluate(const BoardBatch* batch, enum SQUARE_STATE player, LineCounts* out);
+const char* batchEvaluateName();
+
+// individual implementations (for benchmarking / cross checking)
+void batchEvaluateScalar(const BoardBatch* batch, enum SQUARE_STATE player, LineCounts* out);
+#if defined(__x86_64__)
+void batchEvaluateSSE2(const BoardBatch* batch, enum SQUARE_STATE player, LineCounts* out);
+void batchEvaluateAVX2(const BoardBatch* batch, enum SQUARE_STATE player, LineCounts* out);
+bool batchHasAVX2();
+#endif
+
+#endif // _BATCH_EVAL_H_
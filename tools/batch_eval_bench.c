@@ -0,0 +1,129 @@
+/**
+ * Tic-Tac-Toe
+ * Benchmark of the batch position evaluator against the scalar game logic
+ *
+ * Build (from the repository root):
+ *   gcc -O2 -pthread -Iinc -Itools/host -o batch_eval_bench tools/batch_eval_bench.c tools/batch_eval.c src/game_logic.c src/policy_tables.c
+ *
+ * Usage: batch_eval_bench [boards] [passes]
+ **/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <genesis.h>
+#include <game_logic.h>
+#include "batch_eval.h"
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static GameBoard board;
+
+// fill board with a random (legal) position
+static void randomPosition()
+{
+    int moves = randomRange(0, 9);
+
+    clearBoard(&board);
+    board.current_player = CROSS;
+
+    for (int i=0; i<moves; i++)
+    {
+        placePiece(&board, randomMove(&board));
+        nextPlayer(&board);
+    }
+}
+
+// the existing scalar path - countTilesOnWinLine over a GameBoard
+static void evaluateGameLogic(const BoardBatch* batch, enum SQUARE_STATE player, LineCounts* out)
+{
+    for (u32 n=0; n<batch->count; n++)
+    {
+        u8 wins = 0, threats = 0, winnable = 0;
+
+        for (int i=0; i<9; i++)
+        {
+            board.squares[i] = (batch->crosses[n] >> i) & 1 ? CROSS : (batch->noughts[n] >> i) & 1 ? NOUGHT : EMPTY;
+        }
+
+        for (int line_index=0; line_index<8; line_index++)
+        {
+            int owned = countTilesOnWinLine(&board, line_index, player);
+            int empties = countTilesOnWinLine(&board, line_index, EMPTY);
+            if (owned == 3) wins++;
+            if ((owned == 2) && (empties == 1)) threats++;
+            if ((owned == 1) && (empties == 2)) winnable++;
+        }
+
+        out->wins[n] = wins;
+        out->threats[n] = threats;
+        out->winnable[n] = winnable;
+    }
+}
+
+typedef void (*EvaluateFn)(const BoardBatch* batch, enum SQUARE_STATE player, LineCounts* out);
+
+static u8* result[3];
+
+static void run(const char* name, EvaluateFn fn, const BoardBatch* batch, int passes, LineCounts* reference)
+{
+    LineCounts out = { result[0], result[1], result[2] };
+    double start = now();
+
+    for (int pass=0; pass<passes; pass++)
+    {
+        fn(batch, pass & 1 ? NOUGHT : CROSS, &out);
+    }
+
+    double elapsed = now() - start;
+
+    // the last pass is checked against the reference output
+    bool ok = TRUE;
+    if (reference)
+    {
+        ok = memcmp(out.wins, reference->wins, batch->count) == 0 &&
+             memcmp(out.threats, reference->threats, batch->count) == 0 &&
+             memcmp(out.winnable, reference->winnable, batch->count) == 0;
+    }
+
+    printf("%-12s %12.0f boards/s  %8.3f s  %s\n", name, (double)batch->count * passes / elapsed, elapsed, ok ? "ok" : "MISMATCH");
+}
+
+int main(int argc, char** argv)
+{
+    u32 count = argc > 1 ? (u32)atoi(argv[1]) : 1 << 20;
+    int passes = argc > 2 ? atoi(argv[2]) : 20;
+
+    srandom(1);
+
+    u16* crosses = malloc(count * sizeof(u16));
+    u16* noughts = malloc(count * sizeof(u16));
+    for (u32 n=0; n<count; n++)
+    {
+        randomPosition();
+        packBoard(board.squares, &crosses[n], &noughts[n]);
+    }
+
+    for (int i=0; i<3; i++) result[i] = malloc(count);
+    LineCounts reference = { malloc(count), malloc(count), malloc(count) };
+    BoardBatch batch = { count, crosses, noughts };
+
+    printf("%u boards x %d passes, dispatch selects %s\n", count, passes, batchEvaluateName());
+
+    // reference results for the last pass of every run
+    evaluateGameLogic(&batch, passes & 1 ? CROSS : NOUGHT, &reference);
+
+    run("game_logic", evaluateGameLogic, &batch, passes, &reference);
+    run("scalar", batchEvaluateScalar, &batch, passes, &reference);
+#if defined(__x86_64__)
+    run("sse2", batchEvaluateSSE2, &batch, passes, &reference);
+    if (batchHasAVX2()) run("avx2", batchEvaluateAVX2, &batch, passes, &reference);
+#endif
+    run("dispatch", batchEvaluate, &batch, passes, &reference);
+
+    return 0;
+}
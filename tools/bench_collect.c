@@ -0,0 +1,213 @@
+/**
+ * Tic-Tac-Toe
+ * Collector for the on-console benchmark
+ *
+ * Reads the record the hidden benchmark mode (START with B and C held on the
+ * title screen) leaves in SRAM from one or more save files, and sets the cycles
+ * measured with the HV counter against the LOGIC_COST estimates of the same
+ * calls on the same built-in positions (src/benchmark.c). Save files can be in
+ * any of the layouts of tools/sram_dump.c - the one used is where the record is.
+ *
+ * Build (from the repository root):
+ *   gcc -O2 -DLOGIC_COST_MODEL -Iinc -Itools/host -o bench_collect tools/bench_collect.c tools/sram_dump.c src/benchmark.c src/game_logic.c src/policy_tables.c
+ *
+ * Usage: bench_collect [-v] <save file>...
+ *   -v  cycles of every position as well
+ **/
+#include <stdio.h>
+#include <string.h>
+#include <genesis.h>
+#include <game_logic.h>
+#include <benchmark.h>
+#include "sram_dump.h"
+
+typedef struct
+{
+    u8* data;
+    long size;
+    const SramLayout* layout;
+} SaveFile;
+
+static u32 estimates[BENCH_ROWS][BENCH_POSITIONS];
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// save files
+/////////////////////////////////////////////////////////////////////////////////////
+
+static bool loadSave(const char* path, SaveFile* save)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f)
+    {
+        perror(path);
+        return FALSE;
+    }
+    fseek(f, 0, SEEK_END);
+    save->size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    save->data = malloc(save->size);
+    bool read = fread(save->data, 1, save->size, f) == (size_t)save->size;
+    fclose(f);
+    return read;
+}
+
+static u32 readSave(const SaveFile* save, int offset, int bytes)
+{
+    return readSram(save->data, save->size, save->layout, offset, bytes);
+}
+
+static bool findLayout(SaveFile* save)
+{
+    for (int l=0; l<SRAM_LAYOUTS; l++)
+    {
+        if (readSram(save->data, save->size, &sram_layouts[l], BENCH_SRAM, 4) != BENCH_MAGIC) continue;
+        save->layout = &sram_layouts[l];
+        return TRUE;
+    }
+    return FALSE;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// estimates
+/////////////////////////////////////////////////////////////////////////////////////
+
+static void estimate()
+{
+    game_rules = RULES_STANDARD;
+    resetDifficultyLimits();
+    srandom(1);
+
+    for (int p=0; p<BENCH_POSITIONS; p++)
+    {
+        GameBoard board;
+        setupBenchPosition(p, &board);
+
+        for (int opponent=PLAYER_2; opponent<=CPU_HARD; opponent++)
+        {
+            GameBoard copy = board;
+            game_opponent = opponent;
+            logic_cycles = 0;
+            cpuTurn(&copy);
+            estimates[BENCH_CPU_TURN + opponent][p] = logic_cycles;
+        }
+
+        logic_cycles = 0;
+        testWin(&board);
+        estimates[BENCH_TEST_WIN][p] = logic_cycles;
+    }
+}
+
+static void estimateRange(int row, u32* min, u32* avg, u32* max)
+{
+    u32 total = 0;
+    *min = 0xFFFFFFFF;
+    *max = 0;
+    for (int p=0; p<BENCH_POSITIONS; p++)
+    {
+        total += estimates[row][p];
+        if (estimates[row][p] < *min) *min = estimates[row][p];
+        if (estimates[row][p] > *max) *max = estimates[row][p];
+    }
+    *avg = total / BENCH_POSITIONS;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// report
+/////////////////////////////////////////////////////////////////////////////////////
+
+static int report(const char* path, bool verbose)
+{
+    SaveFile save;
+
+    if (!loadSave(path, &save)) return 1;
+    if (!findLayout(&save))
+    {
+        printf("%s: no benchmark record at SRAM 0x%X\n\n", path, BENCH_SRAM);
+        free(save.data);
+        return 1;
+    }
+
+    const SramLayout* layout = save.layout;
+    u32 version = readSave(&save, BENCH_SRAM + 4, 2);
+    u32 rows = readSave(&save, BENCH_SRAM + 6, 2);
+    u32 positions = readSave(&save, BENCH_SRAM + 8, 2);
+    if ((version != BENCH_VERSION) || (rows != BENCH_ROWS) || (positions != BENCH_POSITIONS))
+    {
+        printf("%s: record version %u with %u rows of %u positions, this tool reads version %d (%d x %d)\n\n", path,
+               version, rows, positions, BENCH_VERSION, BENCH_ROWS, BENCH_POSITIONS);
+        free(save.data);
+        return 1;
+    }
+
+    u32 flags = readSave(&save, BENCH_SRAM + 10, 2);
+    u32 frames = readSave(&save, BENCH_SRAM + 12, 4);
+    u32 overhead = readSave(&save, BENCH_SRAM + 16, 4);
+    printf("%s: %s layout, %s, %u frames, %u cycles timing overhead taken off\n", path, layout->name,
+           flags & BENCH_PAL ? "PAL" : "NTSC", frames, overhead);
+    printf("%-12s %8s %8s %8s   %8s %8s %8s   %s\n", "68000 cycles", "min", "avg", "max", "est min", "est avg", "est max", "avg / est");
+
+    for (int r=0; r<BENCH_ROWS; r++)
+    {
+        int at = BENCH_SRAM + BENCH_SRAM_ROWS + r * 12;
+        u32 min = readSave(&save, at, 4);
+        u32 avg = readSave(&save, at + 4, 4);
+        u32 max = readSave(&save, at + 8, 4);
+        printf("%-12s %8u %8u %8u", bench_row_names[r], min, avg, max);
+
+        // scheduling a square is SGDK and the dma scheduler, which the model does not cover
+        if (r == BENCH_SCHEDULE_SQUARE)
+        {
+            printf("   %8s %8s %8s\n", "-", "-", "-");
+            continue;
+        }
+        u32 est_min, est_avg, est_max;
+        estimateRange(r, &est_min, &est_avg, &est_max);
+        printf("   %8u %8u %8u   %5.2f\n", est_min, est_avg, est_max, est_avg ? (double)avg / est_avg : 0);
+    }
+
+    if (verbose)
+    {
+        printf("\n%-8s", "position");
+        for (int r=0; r<BENCH_ROWS; r++) printf(" %11.11s", bench_row_names[r]);
+        printf("\n");
+        for (int p=0; p<BENCH_POSITIONS; p++)
+        {
+            printf("%-8s", bench_positions[p][0] ? bench_positions[p] : "-");
+            for (int r=0; r<BENCH_ROWS; r++) printf(" %11u", readSave(&save, BENCH_SRAM + BENCH_SRAM_SAMPLES + (r * BENCH_POSITIONS + p) * 4, 4));
+            printf("\n");
+        }
+    }
+    printf("\n");
+
+    free(save.data);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    bool verbose = FALSE;
+    int errors = 0;
+    int files = 0;
+
+    estimate();
+    for (int i=1; i<argc; i++)
+    {
+        if (strcmp(argv[i], "-v") == 0)
+        {
+            verbose = TRUE;
+            continue;
+        }
+        errors += report(argv[i], verbose);
+        files++;
+    }
+
+    if (files == 0)
+    {
+        fprintf(stderr, "usage: %s [-v] <save file>...\n", argv[0]);
+        return 1;
+    }
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,224 @@
+/**
+ * Tic-Tac-Toe
+ * Latency benchmark of the cpu player over every reachable position
+ *
+ * Times takeWin, stopLoss, addToWinnableLine, blockLoseableLine and the full
+ * cpuTurn (for every OPPONENT_TYPE) on each reachable, unfinished position and
+ * prints p50 / p99 / max host latency plus the same percentiles of estimated
+ * 68000 cycles from the LOGIC_COST model in game_logic.c. The positions with the
+ * most expensive cpuTurn are listed so regressions in the slow paths show up.
+ *
+ * Build (from the repository root):
+ *   gcc -O2 -DLOGIC_COST_MODEL -Iinc -Itools/host -o cpu_bench tools/cpu_bench.c src/game_logic.c src/policy_tables.c
+ *
+ * Usage: cpu_bench [repeats per position] [worst positions to list]
+ **/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <genesis.h>
+#include <game_logic.h>
+
+#define MAX_POSITIONS 6000
+#define BENCHES 8
+
+typedef struct
+{
+    GameBoard board;
+    u32 cycles[BENCHES];
+    double ns[BENCHES];
+} Position;
+
+static Position positions[MAX_POSITIONS];
+static int position_count;
+static int reachable_count;
+static u8 seen[19683];
+
+static const char* bench_names[BENCHES] = {
+    "takeWin", "stopLoss", "addToWinnableLine", "blockLoseableLine",
+    "cpuTurn PLAYER_2", "cpuTurn CPU_EASY", "cpuTurn CPU_MEDIUM", "cpuTurn CPU_HARD"
+};
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// positions
+/////////////////////////////////////////////////////////////////////////////////////
+
+static int positionCode(GameBoard* board)
+{
+    int code = 0;
+    for (int i=0; i<9; i++) code = code * 3 + board->squares[i];
+    return code;
+}
+
+// every position reachable from an empty board with cross to move, kept with the first move order found
+static void enumerate(GameBoard* board)
+{
+    int code = positionCode(board);
+    if (seen[code]) return;
+    seen[code] = 1;
+    reachable_count++;
+
+    for (int i=0; i<9; i++)
+    {
+        if (board->squares[i] != EMPTY) continue;
+
+        GameBoard next = *board;
+        if (placePiece(&next, i))
+        {
+            // a won position is reachable, but nobody moves in it
+            int won = positionCode(&next);
+            if (!seen[won])
+            {
+                seen[won] = 1;
+                reachable_count++;
+            }
+            continue;
+        }
+        nextPlayer(&next);
+
+        if (next.moves_remaining == 0)
+        {
+            int drawn = positionCode(&next);
+            if (!seen[drawn])
+            {
+                seen[drawn] = 1;
+                reachable_count++;
+            }
+            continue;
+        }
+        enumerate(&next);
+    }
+
+    positions[position_count++].board = *board;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// timing
+/////////////////////////////////////////////////////////////////////////////////////
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static volatile int sink;
+
+static void runBench(int bench, GameBoard* board)
+{
+    int square = 0;
+    GameBoard copy = *board;
+
+    switch (bench)
+    {
+        case 0: takeWin(&copy, &square, copy.current_player); break;
+        case 1: stopLoss(&copy, &square, copy.current_player); break;
+        case 2: addToWinnableLine(&copy, &square, copy.current_player); break;
+        case 3: blockLoseableLine(&copy, &square, copy.current_player); break;
+        default:
+            game_opponent = (enum OPPONENT_TYPE)(bench - 4);
+            square = cpuTurn(&copy);
+            break;
+    }
+    sink += square;
+}
+
+static void measure(Position* p, int repeats)
+{
+    for (int bench=0; bench<BENCHES; bench++)
+    {
+        // same random sequence for every run of a position
+        srandom(positionCode(&p->board));
+        logic_cycles = 0;
+        runBench(bench, &p->board);
+        p->cycles[bench] = logic_cycles;
+
+        double start = now();
+        for (int r=0; r<repeats; r++) runBench(bench, &p->board);
+        p->ns[bench] = (now() - start) * 1e9 / repeats;
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// report
+/////////////////////////////////////////////////////////////////////////////////////
+
+static int sort_bench;
+
+static int compareNs(const void* a, const void* b)
+{
+    double x = (*(Position* const*)a)->ns[sort_bench];
+    double y = (*(Position* const*)b)->ns[sort_bench];
+    return (x > y) - (x < y);
+}
+
+static int compareCycles(const void* a, const void* b)
+{
+    u32 x = (*(Position* const*)a)->cycles[sort_bench];
+    u32 y = (*(Position* const*)b)->cycles[sort_bench];
+    return (x > y) - (x < y);
+}
+
+static void boardString(GameBoard* board, char* s)
+{
+    for (int i=0; i<9; i++) s[i] = board->squares[i] == CROSS ? 'X' : board->squares[i] == NOUGHT ? 'O' : '.';
+    s[9] = 0;
+}
+
+int main(int argc, char** argv)
+{
+    int repeats = argc > 1 ? atoi(argv[1]) : 200;
+    int worst = argc > 2 ? atoi(argv[2]) : 5;
+    static Position* order[MAX_POSITIONS];
+
+    GameBoard empty;
+    resetDifficultyLimits();
+    clearBoard(&empty);
+    empty.current_player = CROSS;
+    enumerate(&empty);
+
+    printf("%d reachable positions, %d with a move to make, %d repeats each\n\n", reachable_count, position_count, repeats);
+
+    for (int i=0; i<position_count; i++)
+    {
+        measure(&positions[i], repeats);
+        order[i] = &positions[i];
+    }
+
+    printf("%-20s %9s %9s %9s   %8s %8s %8s\n", "", "p50 ns", "p99 ns", "max ns", "p50 cyc", "p99 cyc", "max cyc");
+    for (sort_bench=0; sort_bench<BENCHES; sort_bench++)
+    {
+        double ns[3];
+        u32 cycles[3];
+        int at[3] = { position_count / 2, position_count * 99 / 100, position_count - 1 };
+
+        qsort(order, position_count, sizeof(Position*), compareNs);
+        for (int i=0; i<3; i++) ns[i] = order[at[i]]->ns[sort_bench];
+        qsort(order, position_count, sizeof(Position*), compareCycles);
+        for (int i=0; i<3; i++) cycles[i] = order[at[i]]->cycles[sort_bench];
+
+        printf("%-20s %9.1f %9.1f %9.1f   %8u %8u %8u\n", bench_names[sort_bench], ns[0], ns[1], ns[2], cycles[0], cycles[1], cycles[2]);
+    }
+
+    // slowest positions by estimated 68000 cycles, per difficulty
+    for (sort_bench=5; sort_bench<BENCHES; sort_bench++)
+    {
+        printf("\nworst %s positions:\n", bench_names[sort_bench]);
+        qsort(order, position_count, sizeof(Position*), compareCycles);
+        for (int i=0; (i<worst) && (i<position_count); i++)
+        {
+            Position* p = order[position_count - 1 - i];
+            char s[10];
+            boardString(&p->board, s);
+            printf("  %s  %c to move  %6u cycles  %7.1f ns  history", s, p->board.current_player == CROSS ? 'X' : 'O', p->cycles[sort_bench], p->ns[sort_bench]);
+            for (int m=0; m<9-p->board.moves_remaining; m++) printf(" %d", p->board.moves_history[m]);
+            printf("\n");
+        }
+    }
+
+    return 0;
+}
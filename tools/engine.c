@@ -0,0 +1,628 @@
+/**
+ * Tic-Tac-Toe
+ * The cpu player as a text engine over stdin / stdout
+ *
+ * A line based protocol in the manner of UCI, so tools can score positions and
+ * run regressions against the game's own search without linking it in. Requests
+ * go to a pool of worker threads as they are read, and each answer is written as
+ * soon as it is ready - out of order, carrying the id of its request.
+ *
+ *   engine                                     -> id name ..., id rules ..., engineok
+ *   isready                                    -> readyok, once everything sent before it is answered
+ *   go <id> <opponent> <position> [rules]      -> bestmove <id> <square> <piece> <score> nodes <n>
+ *   batch <id> <opponent> <rules> <position>...-> batchmove <id> <count> then <square> <piece> <score> per position
+ *   quit                                       (or end of input) - answers what is in flight, then exits
+ *
+ *   opponent   player2 | easy | medium | hard (OPPONENT_TYPE), searched with the game's default limits
+ *   rules      standard | misere | wild | numerical, standard if left out
+ *   position   9 squares from the top left, then ':' and the side to move - '.' empty, 'x' / 'o'
+ *              (the digits 1-9 under numerical), e.g. x.o.x....:o - and one a game can reach: the side
+ *              to move has put down as many pieces as the other or one fewer (standard, misere), no
+ *              number is down twice and the odd ones, the first player's, are level with the even
+ *              ones or one ahead (numerical)
+ *   square     0-8, piece x / o or the number to put down
+ *   score      cp:<n> the search score, mate:<n> a forced win (or loss, < 0) in n moves of the side
+ *              to move, none if the move was not searched (player2, or no depth)
+ *
+ * Problems come back as "error <id> <message>". The noise of the weaker levels is
+ * seeded from the request id, so a request gets the same answer whichever worker
+ * takes it and however many there are.
+ *
+ * With -b the engine benchmarks itself instead: random positions pushed through the
+ * same parser, queue and workers at 1, 4 and all cores, reporting requests per second
+ * and the latency of each request from being read to being answered, pipelined and
+ * one at a time.
+ *
+ * Build (from the repository root):
+ *   gcc -O2 -pthread -DHOST_RANDOM=engineRandom -Iinc -Itools/host -o engine tools/engine.c src/game_logic.c src/policy_tables.c
+ *
+ * Usage: engine [-w workers]
+ *        engine -b [requests]
+ **/
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <genesis.h>
+#include <game_logic.h>
+
+#define MAX_ID 32
+#define MAX_BATCH 64
+#define MAX_LINE 2048
+#define QUEUE_SIZE 256
+#define BENCH_BATCH 16
+
+static const char* opponent_names[4] = { "player2", "easy", "medium", "hard" };
+static const char* rules_names[4] = { "standard", "misere", "wild", "numerical" };
+
+typedef struct
+{
+    char id[MAX_ID];
+    u8 opponent;
+    u8 rules;
+    bool batch;
+    int count;
+    GameBoard boards[MAX_BATCH];
+    double read_time;
+} Request;
+
+// the request queue, the workers and where the answers go
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    pthread_cond_t idle;
+    Request* queue[QUEUE_SIZE];
+    int head;
+    int count;
+    int in_flight;              // queued or being worked on
+    bool closing;
+
+    pthread_mutex_t output_lock;
+    FILE* output;               // NULL - answers are only counted (benchmark)
+    double* latencies;
+    long answered;
+
+    int worker_count;
+    pthread_t* workers;
+} Engine;
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+#ifndef HOST_RANDOM
+#error "the engine needs its own random() in the game logic too - build with -DHOST_RANDOM=engineRandom"
+#endif
+
+// the search's noise comes from random() - per worker, seeded per request, rather than the C library's
+// shared generator, so answers do not depend on which thread ran them (and no lock is taken per call)
+static __thread u32 worker_seed = 1;
+
+long engineRandom(void)
+{
+    worker_seed ^= worker_seed << 13;
+    worker_seed ^= worker_seed >> 17;
+    worker_seed ^= worker_seed << 5;
+    return worker_seed & 0x7FFFFFFF;
+}
+
+static u32 hashId(const char* id)
+{
+    u32 hash = 2166136261u;
+    for (; *id; id++) hash = (hash ^ (u8)*id) * 16777619u;
+    return hash ? hash : 1;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// parsing
+/////////////////////////////////////////////////////////////////////////////////////
+
+static int findName(const char* const* names, const char* word)
+{
+    for (int i=0; i<4; i++)
+    {
+        if (strcmp(names[i], word) == 0) return i;
+    }
+    // or the enum value
+    if ((word[0] >= '0') && (word[0] <= '3') && (word[1] == 0)) return word[0] - '0';
+    return -1;
+}
+
+// a position token into a board ready to search - NULL or the problem with it
+static const char* parsePosition(const char* token, u8 rules, GameBoard* board)
+{
+    if ((strlen(token) != 11) || (token[9] != ':')) return "position is 9 squares, ':' and the side to move";
+    if ((token[10] != 'x') && (token[10] != 'o')) return "side to move is x or o";
+
+    clearBoard(board);
+    board->current_player = token[10] == 'x' ? CROSS : NOUGHT;
+    int counts[3] = { 0, 0, 0 };    // EMPTY, CROSS, NOUGHT - or the odd and even numbers under numerical
+    u16 numbers = 0;
+    for (int i=0; i<9; i++)
+    {
+        char c = token[i];
+        u8 piece;
+        if (c == '.') continue;
+        if (rules == RULES_NUMERICAL)
+        {
+            if ((c < '1') || (c > '9')) return "squares are . or 1-9 under numerical";
+            piece = c - '0';
+            if (numbers & (1 << piece)) return "a number is down twice";
+            numbers |= 1 << piece;
+            counts[piece & 1 ? CROSS : NOUGHT]++;
+        }
+        else
+        {
+            if ((c != 'x') && (c != 'o')) return "squares are . x or o";
+            piece = c == 'x' ? CROSS : NOUGHT;
+            counts[piece]++;
+        }
+        board->squares[i] = piece;
+        board->moves_history[9 - board->moves_remaining] = i;
+        board->moves_remaining--;
+    }
+
+    if (board->moves_remaining == 0) return "no empty square";
+
+    // either player may have started, but they take turns (wild lets either put down either piece)
+    if (rules == RULES_NUMERICAL)
+    {
+        if ((counts[CROSS] != counts[NOUGHT]) && (counts[CROSS] != counts[NOUGHT] + 1)) return "odd and even numbers do not take turns";
+    }
+    else if (rules != RULES_WILD)
+    {
+        enum SQUARE_STATE other = board->current_player == CROSS ? NOUGHT : CROSS;
+        if ((counts[board->current_player] != counts[other]) && (counts[board->current_player] != counts[other] - 1)) return "pieces do not fit the side to move";
+    }
+
+    // (testWin only looks at the last move, and not before a line could have been made in a game)
+    for (int l=0; l<8; l++)
+    {
+        u8 a = board->squares[winning_lines[l][0]];
+        u8 b = board->squares[winning_lines[l][1]];
+        u8 c = board->squares[winning_lines[l][2]];
+        if (!a || !b || !c) continue;
+        if ((rules == RULES_NUMERICAL) ? (a + b + c == 15) : ((a == b) && (b == c))) return "game is over";
+    }
+    return NULL;
+}
+
+// one request line - NULL for anything that is not a request, with *error set if it was meant to be one
+static Request* parseRequest(char* line, const char** error, char* error_id)
+{
+    char* words[MAX_BATCH + 8];
+    int count = 0;
+
+    *error = NULL;
+    strcpy(error_id, "-");
+    for (char* word = strtok(line, " \t\r\n"); word && (count < MAX_BATCH + 8); word = strtok(NULL, " \t\r\n")) words[count++] = word;
+    if (count == 0) return NULL;
+
+    // every error after this carries the id, if there is one
+    if (count > 1)
+    {
+        if (strlen(words[1]) >= MAX_ID)
+        {
+            *error = "id too long";
+            return NULL;
+        }
+        strcpy(error_id, words[1]);
+    }
+
+    bool batch = strcmp(words[0], "batch") == 0;
+    int positions = batch ? count - 4 : 1;
+    if ((batch && (count < 5)) || (!batch && ((count < 4) || (count > 5))))
+    {
+        *error = batch ? "batch <id> <opponent> <rules> <position>..." : "go <id> <opponent> <position> [rules]";
+        return NULL;
+    }
+    if (positions > MAX_BATCH)
+    {
+        *error = "too many positions in the batch";
+        return NULL;
+    }
+
+    int opponent = findName(opponent_names, words[2]);
+    int rules = batch ? findName(rules_names, words[3]) : (count == 5 ? findName(rules_names, words[4]) : RULES_STANDARD);
+    if (opponent < 0)
+    {
+        *error = "opponent is player2, easy, medium or hard";
+        return NULL;
+    }
+    if (rules < 0)
+    {
+        *error = "rules are standard, misere, wild or numerical";
+        return NULL;
+    }
+
+    Request* request = malloc(sizeof(Request));
+    strcpy(request->id, words[1]);
+    request->opponent = opponent;
+    request->rules = rules;
+    request->batch = batch;
+    request->count = positions;
+    for (int p=0; p<positions; p++)
+    {
+        *error = parsePosition(words[batch ? 4 + p : 3], rules, &request->boards[p]);
+        if (*error)
+        {
+            free(request);
+            return NULL;
+        }
+    }
+    return request;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// answers
+/////////////////////////////////////////////////////////////////////////////////////
+
+static int formatScore(char* out, s16 score, int moves_remaining)
+{
+    if (score == -SEARCH_INFINITY) return sprintf(out, "none");
+
+    // a line made with e squares empty before the move scores SEARCH_WIN + e - 1
+    if ((score >= SEARCH_WIN) || (score <= -SEARCH_WIN))
+    {
+        int plies = moves_remaining - (score < 0 ? -score : score) + SEARCH_WIN;
+        int moves = (plies + 1) / 2;
+        return sprintf(out, "mate:%d", score > 0 ? moves : -moves);
+    }
+    return sprintf(out, "cp:%d", score);
+}
+
+static int formatMove(char* out, GameBoard* board, const Request* request, u32* nodes)
+{
+    SearchContext context;
+    int square;
+
+    if (request->opponent == PLAYER_2)
+    {
+        // as cpuMove - two players, any move will do
+        square = randomMove(board);
+        context.piece = rule_variants[request->rules].nextPiece(board, 0);
+        context.score = -SEARCH_INFINITY;
+        context.nodes = 0;
+    }
+    else
+    {
+        context.limits = default_difficulty_limits[request->opponent];
+        square = rule_variants[request->rules].searchMove(&context, board);
+    }
+    *nodes += context.nodes;
+
+    char piece = request->rules == RULES_NUMERICAL ? '0' + context.piece : context.piece == CROSS ? 'x' : 'o';
+    int length = sprintf(out, "%d %c ", square, piece);
+    return length + formatScore(out + length, context.score, board->moves_remaining);
+}
+
+static void answer(Engine* engine, const char* text, double read_time)
+{
+    pthread_mutex_lock(&engine->output_lock);
+    if (engine->output)
+    {
+        fputs(text, engine->output);
+        fflush(engine->output);
+    }
+    if (engine->latencies) engine->latencies[engine->answered] = now() - read_time;
+    engine->answered++;
+    pthread_mutex_unlock(&engine->output_lock);
+}
+
+static void runRequest(Engine* engine, Request* request)
+{
+    char text[MAX_LINE];
+    u32 nodes = 0;
+    int length;
+
+    worker_seed = hashId(request->id);
+    if (request->batch)
+    {
+        length = sprintf(text, "batchmove %s %d", request->id, request->count);
+        for (int p=0; p<request->count; p++)
+        {
+            text[length++] = ' ';
+            length += formatMove(text + length, &request->boards[p], request, &nodes);
+        }
+        sprintf(text + length, "\n");
+    }
+    else
+    {
+        length = sprintf(text, "bestmove %s ", request->id);
+        length += formatMove(text + length, &request->boards[0], request, &nodes);
+        sprintf(text + length, " nodes %u\n", nodes);
+    }
+    answer(engine, text, request->read_time);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// worker pool
+/////////////////////////////////////////////////////////////////////////////////////
+
+static void* engineWorker(void* arg)
+{
+    Engine* engine = arg;
+
+    while (TRUE)
+    {
+        pthread_mutex_lock(&engine->lock);
+        while ((engine->count == 0) && !engine->closing) pthread_cond_wait(&engine->not_empty, &engine->lock);
+        if (engine->count == 0)
+        {
+            pthread_mutex_unlock(&engine->lock);
+            return NULL;
+        }
+        Request* request = engine->queue[engine->head];
+        engine->head = (engine->head + 1) % QUEUE_SIZE;
+        engine->count--;
+        pthread_cond_signal(&engine->not_full);
+        pthread_mutex_unlock(&engine->lock);
+
+        runRequest(engine, request);
+        free(request);
+
+        pthread_mutex_lock(&engine->lock);
+        if (--engine->in_flight == 0) pthread_cond_broadcast(&engine->idle);
+        pthread_mutex_unlock(&engine->lock);
+    }
+}
+
+static void startEngine(Engine* engine, int workers, FILE* output, double* latencies)
+{
+    memset(engine, 0, sizeof(Engine));
+    pthread_mutex_init(&engine->lock, NULL);
+    pthread_cond_init(&engine->not_empty, NULL);
+    pthread_cond_init(&engine->not_full, NULL);
+    pthread_cond_init(&engine->idle, NULL);
+    pthread_mutex_init(&engine->output_lock, NULL);
+    engine->output = output;
+    engine->latencies = latencies;
+
+    engine->worker_count = workers;
+    engine->workers = malloc(sizeof(pthread_t) * workers);
+    for (int w=0; w<workers; w++) pthread_create(&engine->workers[w], NULL, engineWorker, engine);
+}
+
+// blocks while the queue is full, so a fast sender is held back rather than buffered without end
+static void queueRequest(Engine* engine, Request* request)
+{
+    pthread_mutex_lock(&engine->lock);
+    while (engine->count == QUEUE_SIZE) pthread_cond_wait(&engine->not_full, &engine->lock);
+    engine->queue[(engine->head + engine->count) % QUEUE_SIZE] = request;
+    engine->count++;
+    engine->in_flight++;
+    pthread_cond_signal(&engine->not_empty);
+    pthread_mutex_unlock(&engine->lock);
+}
+
+static void waitIdle(Engine* engine)
+{
+    pthread_mutex_lock(&engine->lock);
+    while (engine->in_flight > 0) pthread_cond_wait(&engine->idle, &engine->lock);
+    pthread_mutex_unlock(&engine->lock);
+}
+
+static void stopEngine(Engine* engine)
+{
+    pthread_mutex_lock(&engine->lock);
+    engine->closing = TRUE;
+    pthread_cond_broadcast(&engine->not_empty);
+    pthread_mutex_unlock(&engine->lock);
+    for (int w=0; w<engine->worker_count; w++) pthread_join(engine->workers[w], NULL);
+    free(engine->workers);
+}
+
+// one line of input - FALSE to quit
+static bool handleLine(Engine* engine, char* line)
+{
+    char command[16] = "";
+    double read_time = now();
+
+    sscanf(line, "%15s", command);
+    if (command[0] == 0) return TRUE;
+
+    if (strcmp(command, "quit") == 0) return FALSE;
+
+    if (strcmp(command, "engine") == 0)
+    {
+        char text[256];
+        sprintf(text, "id name tictactoe %d workers\nid rules %s %s %s %s\nengineok\n", engine->worker_count,
+                rules_names[0], rules_names[1], rules_names[2], rules_names[3]);
+        answer(engine, text, read_time);
+        return TRUE;
+    }
+
+    if (strcmp(command, "isready") == 0)
+    {
+        waitIdle(engine);
+        answer(engine, "readyok\n", read_time);
+        return TRUE;
+    }
+
+    if ((strcmp(command, "go") == 0) || (strcmp(command, "batch") == 0))
+    {
+        const char* error;
+        char id[MAX_ID + 1];
+        Request* request = parseRequest(line, &error, id);
+        if (request)
+        {
+            request->read_time = read_time;
+            queueRequest(engine, request);
+            return TRUE;
+        }
+
+        char text[MAX_LINE];
+        snprintf(text, sizeof(text), "error %s %s\n", id, error);
+        answer(engine, text, read_time);
+        return TRUE;
+    }
+
+    char text[64];
+    snprintf(text, sizeof(text), "error - unknown command %s\n", command);
+    answer(engine, text, read_time);
+    return TRUE;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// benchmark
+/////////////////////////////////////////////////////////////////////////////////////
+
+static int compareDoubles(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// a position of a random game, as a position token
+static void randomPosition(char* token)
+{
+    GameBoard board;
+
+    clearBoard(&board);
+    board.current_player = random() & 1 ? CROSS : NOUGHT;
+    int moves = random() % 8;
+    for (int m=0; m<moves; m++)
+    {
+        if (placePiece(&board, randomMove(&board))) break;
+        nextPlayer(&board);
+    }
+    // the last move may have made a line - take it back
+    if (testWin(&board))
+    {
+        board.squares[board.moves_history[8 - board.moves_remaining]] = EMPTY;
+        board.moves_remaining++;
+    }
+
+    for (int i=0; i<9; i++) token[i] = board.squares[i] == EMPTY ? '.' : board.squares[i] == CROSS ? 'x' : 'o';
+    token[9] = ':';
+    token[10] = board.current_player == CROSS ? 'x' : 'o';
+    token[11] = 0;
+}
+
+// every request line of a run, the opponents in turn
+static char** makeRequests(int count, int batch)
+{
+    char** lines = malloc(sizeof(char*) * count);
+    worker_seed = 1;
+    for (int r=0; r<count; r++)
+    {
+        char* line = lines[r] = malloc(MAX_LINE);
+        const char* opponent = opponent_names[1 + r % 3];
+        int length = batch > 1 ? sprintf(line, "batch b%d %s standard", r, opponent) : sprintf(line, "go r%d %s", r, opponent);
+        for (int p=0; p<batch; p++)
+        {
+            line[length++] = ' ';
+            randomPosition(line + length);
+            length += 11;
+        }
+        line[length] = 0;
+    }
+    return lines;
+}
+
+// pushes lines through an engine with workers threads - one at a time waits for each answer before the next
+static void benchRun(int workers, char** lines, int count, int batch, bool one_at_a_time)
+{
+    Engine engine;
+    double* latencies = malloc(sizeof(double) * count);
+    char line[MAX_LINE];
+
+    startEngine(&engine, workers, NULL, latencies);
+    double start = now();
+    for (int r=0; r<count; r++)
+    {
+        // (strtok writes into the line)
+        strcpy(line, lines[r]);
+        handleLine(&engine, line);
+        if (one_at_a_time) waitIdle(&engine);
+    }
+    waitIdle(&engine);
+    double elapsed = now() - start;
+    stopEngine(&engine);
+
+    qsort(latencies, count, sizeof(double), compareDoubles);
+    char mode[32];
+    if (one_at_a_time) sprintf(mode, "one at a time");
+    else if (batch > 1) sprintf(mode, "batches of %d", batch);
+    else sprintf(mode, "pipelined");
+    printf("%7d  %-14s %12.0f %10.1f %10.1f %10.1f %10.1f\n", workers, mode, count * batch / elapsed,
+           latencies[count / 2] * 1e6, latencies[count * 99 / 100] * 1e6, latencies[count - 1] * 1e6, elapsed * 1e6 / count);
+    free(latencies);
+}
+
+static void benchmark(int requests)
+{
+    int cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int worker_counts[3] = { 1, 4, cores };
+    int batches = requests / BENCH_BATCH > 0 ? requests / BENCH_BATCH : 1;
+    char** single = makeRequests(requests, 1);
+    char** batched = makeRequests(batches, BENCH_BATCH);
+
+    printf("%d requests of random positions, easy / medium / hard in turn, %d cores online\n", requests, cores);
+    printf("latency from a request being read to its answer, per request (per batch for batches)\n\n");
+    printf("%7s  %-14s %12s %10s %10s %10s %10s\n", "workers", "", "positions/s", "p50 us", "p99 us", "max us", "wall us/req");
+    for (int i=0; i<3; i++)
+    {
+        // (all cores may be 1 or 4 already)
+        if ((i == 2) && ((cores == 1) || (cores == 4))) break;
+        benchRun(worker_counts[i], single, requests, 1, TRUE);
+        benchRun(worker_counts[i], single, requests, 1, FALSE);
+        benchRun(worker_counts[i], batched, batches, BENCH_BATCH, FALSE);
+    }
+
+    for (int r=0; r<requests; r++) free(single[r]);
+    for (int r=0; r<batches; r++) free(batched[r]);
+    free(single);
+    free(batched);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// main
+/////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+    int workers = sysconf(_SC_NPROCESSORS_ONLN);
+    int bench_requests = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "w:b")) != -1)
+    {
+        if (opt == 'w') workers = atoi(optarg);
+        else if (opt == 'b') bench_requests = 20000;
+        else
+        {
+            fprintf(stderr, "usage: %s [-w workers]\n       %s -b [requests]\n", argv[0], argv[0]);
+            return 1;
+        }
+    }
+    if ((bench_requests > 0) && (optind < argc)) bench_requests = atoi(argv[optind]);
+    if (workers < 1) workers = 1;
+
+    resetDifficultyLimits();
+    if (bench_requests > 0)
+    {
+        benchmark(bench_requests);
+        return 0;
+    }
+
+    Engine engine;
+    char line[MAX_LINE];
+    startEngine(&engine, workers, stdout, NULL);
+    while (fgets(line, sizeof(line), stdin) && handleLine(&engine, line));
+    waitIdle(&engine);
+    stopEngine(&engine);
+    return 0;
+}
@@ -0,0 +1,379 @@
+/**
+ * Tic-Tac-Toe
+ * RAM/ROM footprint report from the linker map or symbol listing
+ *
+ * Reads either a GNU ld map (link with -Wl,-Map=out/rom.map) or an nm listing
+ * (m68k-elf-nm -S -n out/rom.out > out/symbol.txt) and prints the ROM and RAM
+ * bytes used per section and per symbol. .text and .rodata are ROM, .bss is RAM
+ * and .data is both (the initial values are copied from ROM at startup).
+ * Without sizes in the input, a symbol's size runs to the next symbol.
+ *
+ * Given two files, prints only the symbols that changed size, for measuring a
+ * change against the previous build.
+ *
+ * Build (from the repository root):
+ *   gcc -O2 -Itools/host -o footprint tools/footprint.c
+ *
+ * Usage: footprint <map or symbols> [symbols to list]
+ *        footprint <old map or symbols> <new map or symbols>
+ **/
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <genesis.h>
+
+#define MAX_SYMBOLS 16384
+#define MAX_NAME 128
+
+// anything else (debug info, unwind tables, ...) is SECTION_OTHER and left out of the report
+enum SECTION { SECTION_TEXT, SECTION_RODATA, SECTION_DATA, SECTION_BSS, SECTION_OTHER };
+
+static const char* section_names[] = { "text", "rodata", "data", "bss", "other" };
+
+typedef struct
+{
+    char name[MAX_NAME];
+    char object[MAX_NAME];
+    unsigned long address;
+    unsigned long size;
+    enum SECTION section;
+} Symbol;
+
+typedef struct
+{
+    Symbol* symbols;
+    int count;
+} Footprint;
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// parsing
+/////////////////////////////////////////////////////////////////////////////////////
+
+static enum SECTION sectionFromName(const char* name)
+{
+    if (!strncmp(name, ".text", 5)) return SECTION_TEXT;
+    if (!strncmp(name, ".rodata", 7)) return SECTION_RODATA;
+    if (!strncmp(name, ".data", 5)) return SECTION_DATA;
+    if (!strncmp(name, ".bss", 4) || !strcmp(name, "COMMON")) return SECTION_BSS;
+    return SECTION_OTHER;
+}
+
+static enum SECTION sectionFromType(char type)
+{
+    switch (toupper(type))
+    {
+        case 'T': return SECTION_TEXT;
+        case 'R': return SECTION_RODATA;
+        case 'D': return SECTION_DATA;
+        case 'B': case 'C': return SECTION_BSS;
+        default: return SECTION_OTHER;
+    }
+}
+
+static Symbol* addSymbol(Footprint* fp, const char* name, const char* object, unsigned long address, unsigned long size, enum SECTION section)
+{
+    if (fp->count == MAX_SYMBOLS) return NULL;
+
+    Symbol* s = &fp->symbols[fp->count++];
+    snprintf(s->name, MAX_NAME, "%s", name);
+    snprintf(s->object, MAX_NAME, "%s", object);
+    s->address = address;
+    s->size = size;
+    s->section = section;
+    return s;
+}
+
+// object file name without the directory
+static const char* baseName(const char* path)
+{
+    const char* slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+// one input section of a map and the symbols ld listed inside it
+typedef struct
+{
+    char name[MAX_NAME];
+    char object[MAX_NAME];
+    unsigned long address;
+    unsigned long size;
+    enum SECTION section;
+    int symbol_count;
+    char symbol_names[32][MAX_NAME];
+    unsigned long symbol_addresses[32];
+} InputSection;
+
+static void flushInputSection(Footprint* fp, InputSection* in)
+{
+    if (in->size == 0) return;
+
+    if (in->symbol_count > 1)
+    {
+        // several symbols share the section (built without -ffunction-sections / -fdata-sections)
+        for (int i=0; i<in->symbol_count; i++)
+        {
+            unsigned long end = i + 1 < in->symbol_count ? in->symbol_addresses[i + 1] : in->address + in->size;
+            addSymbol(fp, in->symbol_names[i], in->object, in->symbol_addresses[i], end - in->symbol_addresses[i], in->section);
+        }
+        return;
+    }
+
+    // .text.cpuTurn -> cpuTurn, which also names static symbols ld does not list
+    const char* name = in->symbol_count ? in->symbol_names[0] : in->name;
+    const char* dot = in->symbol_count ? NULL : strchr(in->name + 1, '.');
+    if (dot) name = dot + 1;
+    addSymbol(fp, name, in->object, in->address, in->size, in->section);
+}
+
+static void parseMap(FILE* f, Footprint* fp)
+{
+    char line[512];
+    char output_section[MAX_NAME] = "";
+    // size 0 - nothing to flush until the first input section is read
+    InputSection in = { .name = "", .size = 0, .section = SECTION_OTHER, .symbol_count = 0 };
+    bool in_map = FALSE;
+    bool pending = FALSE;
+
+    while (fgets(line, sizeof(line), f))
+    {
+        char a[MAX_NAME], b[MAX_NAME], c[MAX_NAME], d[MAX_NAME];
+        int tokens = sscanf(line, "%127s %127s %127s %127s", a, b, c, d);
+
+        // skip the discarded sections and memory configuration
+        if (!in_map)
+        {
+            in_map = !strncmp(line, "Linker script and memory map", 28);
+            continue;
+        }
+        if (tokens <= 0) continue;
+
+        // the address / size / object of an input section whose name was too long for its line
+        if (pending)
+        {
+            pending = FALSE;
+            if ((tokens >= 3) && !strncmp(a, "0x", 2))
+            {
+                in.address = strtoul(a, NULL, 16);
+                in.size = strtoul(b, NULL, 16);
+                snprintf(in.object, MAX_NAME, "%s", baseName(c));
+                continue;
+            }
+        }
+
+        // output section
+        if (line[0] == '.')
+        {
+            flushInputSection(fp, &in);
+            in.size = 0;
+            snprintf(output_section, MAX_NAME, "%s", a);
+            continue;
+        }
+
+        // input section
+        if ((line[0] == ' ') && (line[1] != ' ') && (line[1] != '*') && ((a[0] == '.') || !strcmp(a, "COMMON")))
+        {
+            flushInputSection(fp, &in);
+            memset(&in, 0, sizeof(in));
+            snprintf(in.name, MAX_NAME, "%s", a);
+            in.section = sectionFromName(a);
+            if (in.section == SECTION_OTHER) in.section = sectionFromName(output_section);
+
+            if (tokens >= 4)
+            {
+                in.address = strtoul(b, NULL, 16);
+                in.size = strtoul(c, NULL, 16);
+                snprintf(in.object, MAX_NAME, "%s", baseName(d));
+            }
+            else pending = TRUE;
+            continue;
+        }
+
+        // symbol defined in the current input section ("0x... name", not assignments)
+        if ((tokens == 2) && !strncmp(a, "0x", 2) && (isalpha((unsigned char)b[0]) || b[0] == '_') && (in.symbol_count < 32))
+        {
+            snprintf(in.symbol_names[in.symbol_count], MAX_NAME, "%s", b);
+            in.symbol_addresses[in.symbol_count++] = strtoul(a, NULL, 16);
+        }
+    }
+
+    flushInputSection(fp, &in);
+}
+
+static int compareAddress(const void* a, const void* b)
+{
+    unsigned long x = ((const Symbol*)a)->address;
+    unsigned long y = ((const Symbol*)b)->address;
+    return (x > y) - (x < y);
+}
+
+static void parseSymbols(FILE* f, Footprint* fp)
+{
+    char line[512];
+    bool sized = TRUE;
+
+    while (fgets(line, sizeof(line), f))
+    {
+        char a[MAX_NAME], b[MAX_NAME], c[MAX_NAME], d[MAX_NAME];
+        int tokens = sscanf(line, "%127s %127s %127s %127s", a, b, c, d);
+
+        // "address size type name" (nm -S) or "address type name" (nm)
+        if (tokens == 4) addSymbol(fp, d, "", strtoul(a, NULL, 16), strtoul(b, NULL, 16), sectionFromType(c[0]));
+        else if ((tokens == 3) && (strlen(b) == 1))
+        {
+            addSymbol(fp, c, "", strtoul(a, NULL, 16), 0, sectionFromType(b[0]));
+            sized = FALSE;
+        }
+    }
+
+    if (sized) return;
+
+    // no sizes in the listing - each symbol runs to the next one
+    qsort(fp->symbols, fp->count, sizeof(Symbol), compareAddress);
+    for (int i=0; i+1<fp->count; i++)
+    {
+        if (fp->symbols[i].size == 0) fp->symbols[i].size = fp->symbols[i + 1].address - fp->symbols[i].address;
+    }
+}
+
+static bool load(const char* path, Footprint* fp)
+{
+    FILE* f = fopen(path, "r");
+    if (!f)
+    {
+        perror(path);
+        return FALSE;
+    }
+
+    char line[512];
+    bool map = FALSE;
+    while (!map && fgets(line, sizeof(line), f)) map = strstr(line, "Memory Configuration") || strstr(line, "Linker script and memory map");
+    rewind(f);
+
+    fp->symbols = calloc(MAX_SYMBOLS, sizeof(Symbol));
+    fp->count = 0;
+    if (map) parseMap(f, fp);
+    else parseSymbols(f, fp);
+
+    fclose(f);
+    return TRUE;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// report
+/////////////////////////////////////////////////////////////////////////////////////
+
+static bool isRom(enum SECTION section)
+{
+    return (section == SECTION_TEXT) || (section == SECTION_RODATA) || (section == SECTION_DATA);
+}
+
+static bool isRam(enum SECTION section)
+{
+    return (section == SECTION_DATA) || (section == SECTION_BSS);
+}
+
+static void totals(const Footprint* fp, unsigned long* rom, unsigned long* ram)
+{
+    *rom = 0;
+    *ram = 0;
+    for (int i=0; i<fp->count; i++)
+    {
+        if (isRom(fp->symbols[i].section)) *rom += fp->symbols[i].size;
+        if (isRam(fp->symbols[i].section)) *ram += fp->symbols[i].size;
+    }
+}
+
+static int compareSize(const void* a, const void* b)
+{
+    unsigned long x = ((const Symbol*)a)->size;
+    unsigned long y = ((const Symbol*)b)->size;
+    return (x < y) - (x > y);
+}
+
+static void report(Footprint* fp, int listed)
+{
+    unsigned long section_size[5] = { 0 };
+    unsigned long rom, ram;
+
+    for (int i=0; i<fp->count; i++) section_size[fp->symbols[i].section] += fp->symbols[i].size;
+    totals(fp, &rom, &ram);
+
+    printf("%-8s %8s %8s\n", "section", "ROM", "RAM");
+    for (int s=0; s<SECTION_OTHER; s++)
+    {
+        if (section_size[s] == 0) continue;
+        printf("%-8s %8lu %8lu\n", section_names[s], isRom(s) ? section_size[s] : 0, isRam(s) ? section_size[s] : 0);
+    }
+    printf("%-8s %8lu %8lu\n\n", "total", rom, ram);
+
+    qsort(fp->symbols, fp->count, sizeof(Symbol), compareSize);
+    printf("%8s  %-7s  %-32s %s\n", "bytes", "section", "symbol", "object");
+    for (int i=0; (i<fp->count) && (listed>0); i++)
+    {
+        Symbol* s = &fp->symbols[i];
+        if (s->section == SECTION_OTHER) continue;
+        listed--;
+        printf("%8lu  %-7s  %-32s %s\n", s->size, section_names[s->section], s->name, s->object);
+    }
+}
+
+static const Symbol* findSymbol(const Footprint* fp, const Symbol* other)
+{
+    for (int i=0; i<fp->count; i++)
+    {
+        if ((fp->symbols[i].section == other->section) && !strcmp(fp->symbols[i].name, other->name)) return &fp->symbols[i];
+    }
+    return NULL;
+}
+
+static void printChange(const Symbol* old_symbol, const Symbol* new_symbol)
+{
+    const Symbol* s = new_symbol ? new_symbol : old_symbol;
+    unsigned long before = old_symbol ? old_symbol->size : 0;
+    unsigned long after = new_symbol ? new_symbol->size : 0;
+    if ((before == after) || (s->section == SECTION_OTHER)) return;
+    printf("%8lu %8lu %+8ld  %-7s  %s\n", before, after, (long)after - (long)before, section_names[s->section], s->name);
+}
+
+static void compare(const Footprint* old_fp, const Footprint* new_fp)
+{
+    unsigned long old_rom, old_ram, new_rom, new_ram;
+    totals(old_fp, &old_rom, &old_ram);
+    totals(new_fp, &new_rom, &new_ram);
+
+    printf("%8s %8s %8s\n", "before", "after", "change");
+    printf("%8lu %8lu %+8ld  ROM\n", old_rom, new_rom, (long)new_rom - (long)old_rom);
+    printf("%8lu %8lu %+8ld  RAM\n\n", old_ram, new_ram, (long)new_ram - (long)old_ram);
+
+    printf("%8s %8s %8s  %-7s  %s\n", "before", "after", "change", "section", "symbol");
+    for (int i=0; i<old_fp->count; i++) printChange(&old_fp->symbols[i], findSymbol(new_fp, &old_fp->symbols[i]));
+    for (int i=0; i<new_fp->count; i++)
+    {
+        if (!findSymbol(old_fp, &new_fp->symbols[i])) printChange(NULL, &new_fp->symbols[i]);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Footprint fp[2];
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <map or symbols> [symbols to list]\n       %s <old map or symbols> <new map or symbols>\n", argv[0], argv[0]);
+        return 1;
+    }
+    if (!load(argv[1], &fp[0])) return 1;
+
+    // a second file (rather than a count) compares two builds
+    if ((argc > 2) && !isdigit((unsigned char)argv[2][0]))
+    {
+        if (!load(argv[2], &fp[1])) return 1;
+        compare(&fp[0], &fp[1]);
+        return 0;
+    }
+
+    report(&fp[0], argc > 2 ? atoi(argv[2]) : 40);
+    return 0;
+}
@@ -0,0 +1,28 @@
+/**
+ * Tic-Tac-Toe
+ * Minimal stand-in for the SGDK genesis.h so the game logic builds on the host
+ **/
+#ifndef _HOST_GENESIS_H_
+#define _HOST_GENESIS_H_
+
+#include <stdlib.h>
+
+typedef unsigned char u8;
+typedef signed char s8;
+typedef unsigned short u16;
+typedef signed short s16;
+typedef unsigned int u32;
+typedef signed int s32;
+typedef u8 bool;
+
+#define TRUE 1
+#define FALSE 0
+
+// random() comes from the C library (SGDK provides its own u16 version on the console), or from the tool's
+// own generator when built with -DHOST_RANDOM=<function> - in every source, the game logic's included
+#ifdef HOST_RANDOM
+long HOST_RANDOM(void);
+#define random() HOST_RANDOM()
+#endif
+
+#endif // _HOST_GENESIS_H_
@@ -0,0 +1,370 @@
+/**
+ * Tic-Tac-Toe
+ * Link play between two headless consoles over a local socket
+ *
+ * Forks two processes joined by a socketpair, each running the link protocol of
+ * src/link_protocol.c and the game logic at its own frame rate, with bytes held
+ * back for the wire latency and only read once a frame (as the ROM reads them).
+ * A scripted player on each side walks the cursor to the square the cpu search
+ * picks, tapping the pad like a person, and starts the next game from the result
+ * screen, and now and then taps a direction on the other player's turn (which
+ * the lockstep applies if the turn has come round by then). Both processes
+ * report every game they saw; the games must match move for move and frame for
+ * frame, and the local cursor drawn ahead of the lockstep must agree with it
+ * whenever no input is in flight. Prints the round trip in frames, the frames
+ * the lockstep waited, and the bytes sent per move.
+ *
+ * Build (from the repository root):
+ *   gcc -O2 -Iinc -Itools/host -o link_sim tools/link_sim.c src/link_protocol.c src/game_logic.c src/policy_tables.c
+ *
+ * Usage: link_sim [-g games] [-d input delay] [-l latency ms] [-a hz] [-b hz] [-x speed] [-o percent]
+ *
+ * -a / -b are the frame rates of the two consoles (60 / 50 for NTSC against PAL),
+ * -x runs the clocks faster than real time, -o is the chance a frame of the other
+ * player's turn gets a tap (0 for none).
+ **/
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <genesis.h>
+#include <game_logic.h>
+#include <link_protocol.h>
+
+#define MAX_GAMES 256
+#define MAX_PENDING 256
+
+typedef struct
+{
+    u8 moves[9];
+    u8 move_count;
+    u16 end_frame;          // lockstep frame of the last move
+} GameRecord;
+
+typedef struct
+{
+    bool cross;
+    int games;
+    GameRecord records[MAX_GAMES];
+    u32 frames;
+    u32 moves;
+    u32 bytes_sent;
+    u32 stall_frames;
+    u32 rtt_total;
+    u32 rtt_samples;
+    u32 rtt_max;
+    u32 cursor_misses;
+    bool lost;
+} Report;
+
+static int games_wanted = 20;
+static int input_delay = LINK_INPUT_DELAY;
+static double latency_ms = 1;
+static double rates[2] = { 60, 60 };
+static double speed = 4;
+static int off_turn_percent = 5;
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// console
+/////////////////////////////////////////////////////////////////////////////////////
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// the scripted player - decides on a square, then taps towards it
+typedef struct
+{
+    int target;
+    int wait;
+    u8 cursor;              // drawn ahead of the lockstep
+    bool tapped;
+} Player;
+
+static u8 playerButtons(Player* p, LinkSession* link, GameBoard* board, bool game_over, int games)
+{
+    // alternate frames pressed / released, like someone tapping the pad
+    if (p->tapped)
+    {
+        p->tapped = FALSE;
+        return 0;
+    }
+    if (p->wait > 0)
+    {
+        p->wait--;
+        return 0;
+    }
+
+    if (game_over)
+    {
+        // CROSS moves things on, and leaves once enough games are in
+        if (!link->cross) return 0;
+        p->wait = 30;
+        p->tapped = TRUE;
+        return games >= games_wanted ? LINK_C : LINK_A;
+    }
+
+    if (!isLocalTurn(link, board))
+    {
+        // fidgeting while the other player thinks
+        p->target = -1;
+        if ((random() % 100) >= off_turn_percent) return 0;
+        p->tapped = TRUE;
+        return LINK_UP << (random() % 4);
+    }
+
+    if (p->target < 0)
+    {
+        SearchContext context;
+        context.limits = default_difficulty_limits[CPU_MEDIUM];
+        p->target = searchMove(&context, board);
+        p->wait = 10 + random() % 20;
+        return 0;
+    }
+
+    u8 buttons;
+    if (p->cursor == p->target) buttons = LINK_A;
+    else if (p->cursor / 3 != p->target / 3) buttons = p->cursor / 3 < p->target / 3 ? LINK_DOWN : LINK_UP;
+    else buttons = p->cursor < p->target ? LINK_RIGHT : LINK_LEFT;
+
+    // the move goes off with the lockstep, nothing more to do until it comes back
+    if (buttons == LINK_A) p->wait = 1000;
+    p->tapped = TRUE;
+    return buttons;
+}
+
+static void runConsole(int sock, int side, Report* report)
+{
+    LinkSession link;
+    GameBoard board;
+    Player player = { -1, 0, 4, FALSE };
+    u8 square = 4;
+    bool game_over = FALSE;
+    u8 pending[MAX_PENDING];
+    double pending_due[MAX_PENDING];
+    int pending_head = 0;
+    int pending_count = 0;
+
+    memset(report, 0, sizeof(*report));
+    srandom(getpid());
+    startLink(&link, input_delay);
+    clearBoard(&board);
+    board.current_player = CROSS;
+
+    double period = 1.0 / (rates[side] * speed);
+    double latency = latency_ms / 1000.0 / speed;
+    double next = now();
+
+    while (TRUE)
+    {
+        next += period;
+        double t = now();
+        if (next > t)
+        {
+            struct timespec ts = { 0, (long)((next - t) * 1e9) };
+            nanosleep(&ts, NULL);
+        }
+        t = now();
+
+        // the wire: whatever is due goes out, everything that has arrived is read once a frame
+        while ((pending_count > 0) && (pending_due[pending_head] <= t))
+        {
+            // (the other console may already have left)
+            if (send(sock, &pending[pending_head], 1, MSG_NOSIGNAL) != 1) break;
+            pending_head = (pending_head + 1) % MAX_PENDING;
+            pending_count--;
+        }
+        u8 in[64];
+        ssize_t got;
+        while ((got = read(sock, in, sizeof(in))) > 0)
+        {
+            for (int i=0; i<got; i++) linkReceive(&link, in[i]);
+        }
+
+        Player before = player;
+        u8 buttons = link.state == LINK_PLAYING ? playerButtons(&player, &link, &board, game_over, report->games) : 0;
+        bool playing = link.state == LINK_PLAYING;
+        s16 byte = linkSend(&link, buttons);
+        if (playing && (byte < 0)) player = before;
+        if ((byte >= 0) && (pending_count < MAX_PENDING))
+        {
+            int slot = (pending_head + pending_count++) % MAX_PENDING;
+            pending[slot] = byte;
+            pending_due[slot] = t + latency;
+        }
+
+        if (link.state == LINK_LOST)
+        {
+            report->lost = TRUE;
+            break;
+        }
+
+        // at most two lockstep frames a frame, to catch up after a wait
+        u8 pressed[2];
+        bool quit = FALSE;
+        for (int step=0; (step < 2) && linkStep(&link, pressed); step++)
+        {
+            enum LINK_ACTION action = linkAction(&board, game_over, pressed, &square);
+            if (action == LINK_TAKE)
+            {
+                GameRecord* record = &report->records[report->games];
+                record->moves[record->move_count++] = square;
+                report->moves++;
+
+                bool win = placePiece(&board, square);
+                nextPlayer(&board);
+                player.wait = 0;
+                if (win || (board.moves_remaining == 0))
+                {
+                    record->end_frame = link.sim_frame;
+                    if (report->games < MAX_GAMES - 1) report->games++;
+                    game_over = TRUE;
+                }
+            }
+            if (action == LINK_NEXT_GAME)
+            {
+                // as resetGame - the board is emptied, the player to move stays as it was
+                clearBoard(&board);
+                game_over = FALSE;
+                square = 4;
+                player.wait = 0;
+            }
+            if (action == LINK_QUIT) quit = TRUE;
+        }
+
+        // the cursor is drawn ahead of the lockstep from the presses that went out, as the ROM does - and
+        // once nothing is in flight it has to be where the lockstep put it
+        player.cursor = game_over ? square : linkPredictCursor(&link, &board, square);
+        bool settled = link.sim_frame == link.send_frame + link.input_delay;
+        if (playing && settled && (player.cursor != square)) report->cursor_misses++;
+
+        if (link.rtt)
+        {
+            report->rtt_total += link.rtt;
+            report->rtt_samples++;
+        }
+        if (quit) break;
+    }
+
+    // what is still on the wire has to reach the other console, it may still need it
+    while (pending_count > 0)
+    {
+        if (pending_due[pending_head] > now()) continue;
+        if (send(sock, &pending[pending_head], 1, MSG_NOSIGNAL) != 1) break;
+        pending_head = (pending_head + 1) % MAX_PENDING;
+        pending_count--;
+    }
+
+    report->cross = link.cross;
+    report->frames = link.frame;
+    report->bytes_sent = link.bytes_sent;
+    report->stall_frames = link.stall_frames;
+    report->rtt_max = link.rtt_max;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// report
+/////////////////////////////////////////////////////////////////////////////////////
+
+static bool readAll(int fd, void* buffer, size_t size)
+{
+    u8* p = buffer;
+    while (size > 0)
+    {
+        ssize_t got = read(fd, p, size);
+        if (got <= 0) return FALSE;
+        p += got;
+        size -= got;
+    }
+    return TRUE;
+}
+
+int main(int argc, char** argv)
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "g:d:l:a:b:x:o:")) != -1)
+    {
+        if (opt == 'g') games_wanted = atoi(optarg);
+        else if (opt == 'd') input_delay = atoi(optarg);
+        else if (opt == 'l') latency_ms = atof(optarg);
+        else if (opt == 'a') rates[0] = atof(optarg);
+        else if (opt == 'b') rates[1] = atof(optarg);
+        else if (opt == 'x') speed = atof(optarg);
+        else if (opt == 'o') off_turn_percent = atoi(optarg);
+        else
+        {
+            fprintf(stderr, "usage: link_sim [-g games] [-d input delay] [-l latency ms] [-a hz] [-b hz] [-x speed] [-o percent]\n");
+            return 1;
+        }
+    }
+    if (games_wanted > MAX_GAMES - 1) games_wanted = MAX_GAMES - 1;
+
+    int wire[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, wire) < 0)
+    {
+        perror("socketpair");
+        return 1;
+    }
+
+    static Report reports[2];
+    int results[2][2];
+    pid_t pids[2];
+    for (int side=0; side<2; side++)
+    {
+        pipe(results[side]);
+        pids[side] = fork();
+        if (pids[side] == 0)
+        {
+            static Report report;
+            close(wire[1 - side]);
+            fcntl(wire[side], F_SETFL, O_NONBLOCK);
+            runConsole(wire[side], side, &report);
+            write(results[side][1], &report, sizeof(report));
+            _exit(0);
+        }
+        close(results[side][1]);
+    }
+    close(wire[0]);
+    close(wire[1]);
+
+    for (int side=0; side<2; side++)
+    {
+        if (!readAll(results[side][0], &reports[side], sizeof(Report))) reports[side].lost = TRUE;
+        waitpid(pids[side], NULL, 0);
+    }
+
+    printf("input delay %d, latency %.1f ms, consoles at %.0f / %.0f Hz\n\n", input_delay, latency_ms, rates[0], rates[1]);
+    printf("%-8s %6s %6s %6s %8s %8s %8s %10s %8s\n", "console", "plays", "games", "frames", "stalls", "rtt avg", "rtt max", "bytes/move", "misses");
+    for (int side=0; side<2; side++)
+    {
+        Report* r = &reports[side];
+        printf("%-8c %6s %6d %6u %8u %8.2f %8u %10.1f %8u%s\n", 'A' + side, r->cross ? "X" : "O", r->games, r->frames, r->stall_frames,
+               r->rtt_samples ? (double)r->rtt_total / r->rtt_samples : 0.0, r->rtt_max,
+               r->moves ? (double)r->bytes_sent / r->moves : 0.0, r->cursor_misses, r->lost ? "  LINK LOST" : "");
+    }
+
+    // lockstep - both consoles must have seen exactly the same games
+    int mismatches = 0;
+    int games = reports[0].games < reports[1].games ? reports[0].games : reports[1].games;
+    if (reports[0].games != reports[1].games) mismatches++;
+    for (int g=0; g<games; g++)
+    {
+        GameRecord* a = &reports[0].records[g];
+        GameRecord* b = &reports[1].records[g];
+        if ((a->move_count != b->move_count) || memcmp(a->moves, b->moves, a->move_count) || (a->end_frame != b->end_frame)) mismatches++;
+    }
+    printf("\n%d games compared, %d mismatches, %.1f bytes/s on the wire (4800 baud carries 480)\n", games, mismatches,
+           reports[0].frames ? reports[0].bytes_sent * rates[0] / reports[0].frames : 0.0);
+
+    bool misses = reports[0].cursor_misses || reports[1].cursor_misses;
+    return (mismatches || misses || reports[0].lost || reports[1].lost) ? 1 : 0;
+}
@@ -0,0 +1,644 @@
+/**
+ * Tic-Tac-Toe
+ * Self-play trainer for CPU_EASY / CPU_MEDIUM style move tables
+ *
+ * Learns a move value for every (canonical) position by tabular Q-learning over
+ * self-play games, with each worker thread training its own copy of the table
+ * that is averaged back together after every round. Each difficulty is then a
+ * softmax over those values, with the temperature searched until a reference
+ * player wins the requested share of games, and quantised to u8 weights.
+ *
+ * The ROM plays every difficulty with the search now, so the weights only go
+ * to the file given with -w; what the ROM does use is the sorted list of the
+ * canonical positions and their exact values (for the analysis overlay), written
+ * out as src/policy_tables.c / inc/policy_tables.h.
+ *
+ * Build (from the repository root):
+ *   gcc -O2 -pthread -Iinc -Itools/host -o policy_train tools/policy_train.c src/game_logic.c src/policy_tables.c -lm
+ *
+ * Usage: policy_train [-t threads] [-g games per round] [-e easy win rate] [-m medium win rate] [-o repo root] [-w weights file]
+ *
+ * Win rates are those of the reference player, which plays a perfect move 3 times
+ * in 4 and a random move otherwise.
+ **/
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <genesis.h>
+#include <game_logic.h>
+
+#define MAX_POSITIONS 1024
+#define ROUNDS_MAX 200
+#define LEARNING_RATE 0.2f
+#define EXPLORATION 0.25f
+#define REFERENCE_SKILL 75
+#define EVAL_GAMES 200000
+
+typedef struct
+{
+    u8 board[9];
+    u8 player;
+    int moves;
+} Position;
+
+typedef struct
+{
+    int thread_index;
+    u32 seed;
+    int games;
+    float (*q)[9];
+    const u8 (*weights)[9];
+    int player_wins;
+    int cpu_wins;
+} Worker;
+
+// all non-terminal canonical positions (side to move relative)
+static u16 positions[MAX_POSITIONS];
+static int position_count;
+
+// exact game values (side to move: 1 win, 0 draw, -1 loss) for checking convergence
+static s8 exact_value[MAX_POSITIONS][9];
+
+// exact values for the ROM, counting the moves too (POSITION_UNKNOWN in game_logic.h)
+static s8 position_value[MAX_POSITIONS];
+
+static float shared_q[MAX_POSITIONS][9];
+
+static int thread_count;
+static int games_per_round = 100000;
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// positions
+/////////////////////////////////////////////////////////////////////////////////////
+
+static u32 nextRandom(u32* seed)
+{
+    // xorshift32
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+    return *seed;
+}
+
+static bool isWin(const u8* board, enum SQUARE_STATE player)
+{
+    for (int line_index=0; line_index<8; line_index++)
+    {
+        if ((board[winning_lines[line_index][0]] == player) &&
+            (board[winning_lines[line_index][1]] == player) &&
+            (board[winning_lines[line_index][2]] == player)) return TRUE;
+    }
+    return FALSE;
+}
+
+static enum SQUARE_STATE otherPlayer(enum SQUARE_STATE player)
+{
+    return player == NOUGHT ? CROSS : NOUGHT;
+}
+
+static int positionIndex(u16 code)
+{
+    int lo = 0;
+    int hi = position_count - 1;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (positions[mid] < code) lo = mid + 1;
+        else hi = mid;
+    }
+    return positions[lo] == code ? lo : -1;
+}
+
+static u8 seen[19683];
+
+static void enumerate(Position* p)
+{
+    int symmetry;
+    u16 code = canonicalPosition(p->board, p->player, &symmetry);
+    if (seen[code]) return;
+    seen[code] = 1;
+    positions[position_count++] = code;
+
+    for (int i=0; i<9; i++)
+    {
+        if (p->board[i] != EMPTY) continue;
+        p->board[i] = p->player;
+        if (!isWin(p->board, p->player) && (p->moves < 8))
+        {
+            Position next = *p;
+            next.player = otherPlayer(p->player);
+            next.moves++;
+            enumerate(&next);
+        }
+        p->board[i] = EMPTY;
+    }
+}
+
+static int compareCodes(const void* a, const void* b)
+{
+    return *(const u16*)a - *(const u16*)b;
+}
+
+// canonical board for a position index (player to move is CROSS)
+static void decodePosition(int index, Position* p)
+{
+    u16 code = positions[index];
+    p->moves = 0;
+    for (int i=8; i>=0; i--)
+    {
+        int v = code % 3;
+        code /= 3;
+        p->board[i] = v == 0 ? EMPTY : v == 1 ? CROSS : NOUGHT;
+        if (v) p->moves++;
+    }
+    p->player = CROSS;
+}
+
+static s8 solve(Position* p)
+{
+    s8 best = -2;
+    for (int i=0; i<9; i++)
+    {
+        if (p->board[i] != EMPTY) continue;
+        s8 value;
+        p->board[i] = p->player;
+        if (isWin(p->board, p->player)) value = 1;
+        else if (p->moves == 8) value = 0;
+        else
+        {
+            Position next = *p;
+            next.player = otherPlayer(p->player);
+            next.moves++;
+            value = -solve(&next);
+        }
+        p->board[i] = EMPTY;
+        if (value > best) best = value;
+    }
+    return best;
+}
+
+static s8 positionValue(Position* p);
+
+// as moveValue in game_logic.c: a win with n squares left empty is n + 1
+static s8 valueAfterMove(Position* p, int square)
+{
+    s8 value;
+    p->board[square] = p->player;
+    if (isWin(p->board, p->player)) value = 9 - p->moves;
+    else if (p->moves == 8) value = 0;
+    else
+    {
+        Position next = *p;
+        next.player = otherPlayer(p->player);
+        next.moves++;
+        value = -positionValue(&next);
+    }
+    p->board[square] = EMPTY;
+    return value;
+}
+
+static s8 positionValue(Position* p)
+{
+    int symmetry;
+    int index = positionIndex(canonicalPosition(p->board, p->player, &symmetry));
+    if (position_value[index] != POSITION_UNKNOWN) return position_value[index];
+
+    s8 best = -10;
+    for (int i=0; i<9; i++)
+    {
+        if (p->board[i] != EMPTY) continue;
+        s8 value = valueAfterMove(p, i);
+        if (value > best) best = value;
+    }
+    position_value[index] = best;
+    return best;
+}
+
+static void solvePositions()
+{
+    for (int index=0; index<position_count; index++) position_value[index] = POSITION_UNKNOWN;
+
+    for (int index=0; index<position_count; index++)
+    {
+        Position p;
+        decodePosition(index, &p);
+        for (int i=0; i<9; i++)
+        {
+            exact_value[index][i] = -2;
+            if (p.board[i] != EMPTY) continue;
+            p.board[i] = p.player;
+            if (isWin(p.board, p.player)) exact_value[index][i] = 1;
+            else if (p.moves == 8) exact_value[index][i] = 0;
+            else
+            {
+                Position next = p;
+                next.player = otherPlayer(p.player);
+                next.moves++;
+                exact_value[index][i] = -solve(&next);
+            }
+            p.board[i] = EMPTY;
+        }
+        positionValue(&p);
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// self-play training
+/////////////////////////////////////////////////////////////////////////////////////
+
+static int bestAction(const float* q, const Position* p, int symmetry)
+{
+    int best = -1;
+    for (int i=0; i<9; i++)
+    {
+        if (p->board[board_symmetries[symmetry][i]] != EMPTY) continue;
+        if ((best < 0) || (q[i] > q[best])) best = i;
+    }
+    return best;
+}
+
+static int randomAction(const Position* p, int symmetry, u32* seed)
+{
+    int r = nextRandom(seed) % (9 - p->moves);
+    for (int i=0; i<9; i++)
+    {
+        if (p->board[board_symmetries[symmetry][i]] != EMPTY) continue;
+        if (r-- == 0) return i;
+    }
+    return -1;
+}
+
+static void* trainWorker(void* arg)
+{
+    Worker* w = arg;
+
+    for (int game=0; game<w->games; game++)
+    {
+        Position p = { { EMPTY }, nextRandom(&w->seed) & 1 ? CROSS : NOUGHT, 0 };
+
+        while (TRUE)
+        {
+            int symmetry;
+            int index = positionIndex(canonicalPosition(p.board, p.player, &symmetry));
+            float* q = w->q[index];
+            bool explore = (nextRandom(&w->seed) & 0xFFFF) < EXPLORATION * 0x10000;
+            int action = explore ? randomAction(&p, symmetry, &w->seed) : bestAction(q, &p, symmetry);
+            int square = board_symmetries[symmetry][action];
+            float target;
+
+            p.board[square] = p.player;
+            p.moves++;
+
+            if (isWin(p.board, p.player)) target = 1;
+            else if (p.moves == 9) target = 0;
+            else
+            {
+                // negamax backup - the opponent's best reply
+                int next_symmetry;
+                enum SQUARE_STATE next_player = otherPlayer(p.player);
+                int next_index = positionIndex(canonicalPosition(p.board, next_player, &next_symmetry));
+                Position next = p;
+                next.player = next_player;
+                target = -w->q[next_index][bestAction(w->q[next_index], &next, next_symmetry)];
+            }
+
+            q[action] += LEARNING_RATE * (target - q[action]);
+
+            if ((target == 1) || (p.moves == 9)) break;
+            p.player = otherPlayer(p.player);
+        }
+    }
+
+    return NULL;
+}
+
+// the share of positions where the greedy move is not game theoretically optimal
+static int greedyErrors()
+{
+    int errors = 0;
+    for (int index=0; index<position_count; index++)
+    {
+        Position p;
+        decodePosition(index, &p);
+        int action = bestAction(shared_q[index], &p, 0);
+        s8 best = -2;
+        for (int i=0; i<9; i++) if (exact_value[index][i] > best) best = exact_value[index][i];
+        if (exact_value[index][action] != best) errors++;
+    }
+    return errors;
+}
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void train()
+{
+    Worker workers[thread_count];
+    pthread_t threads[thread_count];
+    float (*tables)[MAX_POSITIONS][9] = malloc(sizeof(float) * MAX_POSITIONS * 9 * thread_count);
+    double start = now();
+    double converged = -1;
+    long games = 0;
+    int stable_rounds = 0;
+
+    for (int round=0; (round<ROUNDS_MAX) && (stable_rounds<5); round++)
+    {
+        for (int t=0; t<thread_count; t++)
+        {
+            memcpy(tables[t], shared_q, sizeof(shared_q));
+            workers[t] = (Worker){ t, 0x9E3779B9u * (round * thread_count + t + 1), games_per_round / thread_count, tables[t], NULL, 0, 0 };
+            pthread_create(&threads[t], NULL, trainWorker, &workers[t]);
+        }
+        for (int t=0; t<thread_count; t++)
+        {
+            pthread_join(threads[t], NULL);
+            games += workers[t].games;
+        }
+
+        // average the thread tables back together
+        for (int index=0; index<position_count; index++)
+        {
+            for (int i=0; i<9; i++)
+            {
+                float sum = 0;
+                for (int t=0; t<thread_count; t++) sum += tables[t][index][i];
+                shared_q[index][i] = sum / thread_count;
+            }
+        }
+
+        int errors = greedyErrors();
+        if (errors == 0)
+        {
+            if (converged < 0) converged = now() - start;
+            stable_rounds++;
+        }
+        else
+        {
+            converged = -1;
+            stable_rounds = 0;
+        }
+        printf("round %3d: %9ld games, %4d/%d positions with a non optimal greedy move\n", round, games, errors, position_count);
+    }
+
+    double elapsed = now() - start;
+    printf("trained %ld games in %.2f s (%.0f games/s, %d threads)\n", games, elapsed, games / elapsed, thread_count);
+    if (converged >= 0) printf("greedy policy converged to perfect play after %.2f s\n", converged);
+    else printf("greedy policy did not converge\n");
+
+    free(tables);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// difficulty tuning
+/////////////////////////////////////////////////////////////////////////////////////
+
+static void quantise(float temperature, u8 (*weights)[9])
+{
+    for (int index=0; index<position_count; index++)
+    {
+        Position p;
+        decodePosition(index, &p);
+        int best = bestAction(shared_q[index], &p, 0);
+        for (int i=0; i<9; i++)
+        {
+            weights[index][i] = 0;
+            if (p.board[i] != EMPTY) continue;
+            // relative to the best move, which always gets 255
+            double w = exp((shared_q[index][i] - shared_q[index][best]) / temperature);
+            weights[index][i] = (u8)lround(255 * w);
+        }
+    }
+}
+
+static int weightedAction(const u8* w, u32* seed)
+{
+    int total = 0;
+    for (int i=0; i<9; i++) total += w[i];
+    int r = nextRandom(seed) % total;
+    for (int i=0; i<9; i++)
+    {
+        if (r < w[i]) return i;
+        r -= w[i];
+    }
+    return -1;
+}
+
+static void* evaluateWorker(void* arg)
+{
+    Worker* w = arg;
+
+    for (int game=0; game<w->games; game++)
+    {
+        // the starting player alternates between games, as on the console
+        Position p = { { EMPTY }, game & 1 ? CROSS : NOUGHT, 0 };
+
+        while (TRUE)
+        {
+            int symmetry;
+            int index = positionIndex(canonicalPosition(p.board, p.player, &symmetry));
+            int action;
+
+            if (p.player == NOUGHT)
+            {
+                action = weightedAction(w->weights[index], &w->seed);
+            }
+            else if ((int)(nextRandom(&w->seed) % 100) < REFERENCE_SKILL)
+            {
+                // perfect move, chosen at random between equals
+                s8 best = -2;
+                int count = 0;
+                for (int i=0; i<9; i++) if (exact_value[index][i] > best) best = exact_value[index][i];
+                for (int i=0; i<9; i++) if (exact_value[index][i] == best) count++;
+                int r = nextRandom(&w->seed) % count;
+                for (action=0; action<9; action++) if ((exact_value[index][action] == best) && (r-- == 0)) break;
+            }
+            else
+            {
+                action = randomAction(&p, symmetry, &w->seed);
+            }
+
+            p.board[board_symmetries[symmetry][action]] = p.player;
+            p.moves++;
+
+            if (isWin(p.board, p.player))
+            {
+                if (p.player == CROSS) w->player_wins++;
+                else w->cpu_wins++;
+                break;
+            }
+            if (p.moves == 9) break;
+            p.player = otherPlayer(p.player);
+        }
+    }
+
+    return NULL;
+}
+
+static double playerWinRate(const u8 (*weights)[9])
+{
+    Worker workers[thread_count];
+    pthread_t threads[thread_count];
+    int wins = 0;
+
+    for (int t=0; t<thread_count; t++)
+    {
+        workers[t] = (Worker){ t, 0x2545F491u * (t + 1), EVAL_GAMES / thread_count, NULL, weights, 0, 0 };
+        pthread_create(&threads[t], NULL, evaluateWorker, &workers[t]);
+    }
+    for (int t=0; t<thread_count; t++)
+    {
+        pthread_join(threads[t], NULL);
+        wins += workers[t].player_wins;
+    }
+
+    return (double)wins / (EVAL_GAMES / thread_count * thread_count);
+}
+
+static void tune(const char* name, double target, u8 (*weights)[9])
+{
+    // bisect log(temperature) - the reference player wins more as the cpu gets noisier
+    double lo = log(0.001);
+    double hi = log(100.0);
+    double rate = 0;
+
+    for (int step=0; step<24; step++)
+    {
+        double mid = (lo + hi) / 2;
+        quantise(exp(mid), weights);
+        rate = playerWinRate(weights);
+        if (rate < target) lo = mid;
+        else hi = mid;
+    }
+
+    quantise(exp((lo + hi) / 2), weights);
+    rate = playerWinRate(weights);
+    printf("%-10s temperature %.4f, reference player wins %.1f%% (target %.1f%%)\n", name, exp((lo + hi) / 2), rate * 100, target * 100);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// export
+/////////////////////////////////////////////////////////////////////////////////////
+
+static void writeTable(FILE* f, const char* name, const u8 (*weights)[9])
+{
+    fprintf(f, "\nconst u8 %s[POLICY_POSITIONS][9] = {\n", name);
+    for (int index=0; index<position_count; index++)
+    {
+        fprintf(f, "    {");
+        for (int i=0; i<9; i++) fprintf(f, "%s%3d", i ? ", " : "", weights[index][i]);
+        fprintf(f, "},\n");
+    }
+    fprintf(f, "};\n");
+}
+
+static FILE* openOutput(const char* path)
+{
+    FILE* f = fopen(path, "w");
+    if (!f)
+    {
+        perror(path);
+        exit(1);
+    }
+    return f;
+}
+
+static void writeTables(const char* root)
+{
+    char path[512];
+
+    snprintf(path, sizeof(path), "%s/inc/policy_tables.h", root);
+    FILE* f = openOutput(path);
+    fprintf(f, "/**\n * Tic-Tac-Toe\n * Canonical position tables - generated by tools/policy_train.c, do not edit\n **/\n");
+    fprintf(f, "#ifndef _POLICY_TABLES_H_\n#define _POLICY_TABLES_H_\n\n#include <genesis.h>\n\n");
+    fprintf(f, "#define POLICY_POSITIONS %d\n\n", position_count);
+    fprintf(f, "// canonicalPosition() codes, sorted\nextern const u16 policy_positions[POLICY_POSITIONS];\n\n");
+    fprintf(f, "// exact value of each for the side to move (see POSITION_UNKNOWN in game_logic.h)\nextern const s8 position_values[POLICY_POSITIONS];\n\n");
+    fprintf(f, "#endif // _POLICY_TABLES_H_\n");
+    fclose(f);
+
+    snprintf(path, sizeof(path), "%s/src/policy_tables.c", root);
+    f = openOutput(path);
+    fprintf(f, "/**\n * Tic-Tac-Toe\n * Canonical position tables - generated by tools/policy_train.c, do not edit\n **/\n");
+    fprintf(f, "#include <genesis.h>\n#include <policy_tables.h>\n\n");
+    fprintf(f, "const u16 policy_positions[POLICY_POSITIONS] = {");
+    for (int index=0; index<position_count; index++) fprintf(f, "%s%s%5d", index ? "," : "", index % 12 ? " " : "\n    ", positions[index]);
+    fprintf(f, "\n};\n\n");
+    fprintf(f, "const s8 position_values[POLICY_POSITIONS] = {");
+    for (int index=0; index<position_count; index++) fprintf(f, "%s%s%3d", index ? "," : "", index % 16 ? " " : "\n    ", position_value[index]);
+    fprintf(f, "\n};\n");
+    fclose(f);
+
+    printf("wrote %d positions, %d bytes of rom\n", position_count, position_count * 3);
+}
+
+// the trained weights, indexed as policy_positions, for the host side only
+static void writeWeights(const char* path, const u8 (*easy)[9], const u8 (*medium)[9])
+{
+    FILE* f = openOutput(path);
+    fprintf(f, "/**\n * Tic-Tac-Toe\n * Self-play trained move weights - generated by tools/policy_train.c, do not edit\n **/\n");
+    fprintf(f, "#include <genesis.h>\n#include <policy_tables.h>\n\n");
+    fprintf(f, "// move weights per position of policy_positions, in canonical square order");
+    writeTable(f, "policy_easy", easy);
+    writeTable(f, "policy_medium", medium);
+    fclose(f);
+    printf("wrote the move weights to %s\n", path);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// main
+/////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+    double easy_target = 0.45;
+    double medium_target = 0.20;
+    const char* root = ".";
+    const char* weights_path = NULL;
+    int opt;
+
+    thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+    while ((opt = getopt(argc, argv, "t:g:e:m:o:w:")) != -1)
+    {
+        if (opt == 't') thread_count = atoi(optarg);
+        else if (opt == 'g') games_per_round = atoi(optarg);
+        else if (opt == 'e') easy_target = atof(optarg);
+        else if (opt == 'm') medium_target = atof(optarg);
+        else if (opt == 'o') root = optarg;
+        else if (opt == 'w') weights_path = optarg;
+        else
+        {
+            fprintf(stderr, "usage: %s [-t threads] [-g games per round] [-e easy win rate] [-m medium win rate] [-o repo root] [-w weights file]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (thread_count < 1) thread_count = 1;
+
+    Position empty = { { EMPTY }, CROSS, 0 };
+    enumerate(&empty);
+    qsort(positions, position_count, sizeof(u16), compareCodes);
+    solvePositions();
+    printf("%d canonical positions\n", position_count);
+
+    train();
+
+    static u8 easy[MAX_POSITIONS][9];
+    static u8 medium[MAX_POSITIONS][9];
+    tune("CPU_EASY", easy_target, easy);
+    tune("CPU_MEDIUM", medium_target, medium);
+
+    writeTables(root);
+    if (weights_path) writeWeights(weights_path, (const u8 (*)[9])easy, (const u8 (*)[9])medium);
+    return 0;
+}
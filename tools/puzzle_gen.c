@@ -0,0 +1,456 @@
+/**
+ * Tic-Tac-Toe
+ * Generator of the "win in N" puzzles
+ *
+ * Solves every position with CROSS to move and keeps those CROSS wins by force
+ * in exactly N of its own moves (N up to -n) with a single winning move at every
+ * step, against the defence that holds out longest (the lowest square of those
+ * that do). Only one position of each set of rotations / reflections is looked
+ * at, so no two puzzles are the same under symmetry. The positions are dealt out
+ * to the worker threads, each solving with its own table of exact values.
+ *
+ * Reports positions and solver nodes per second on 1 thread and on all of them,
+ * checks every puzzle through src/puzzles.c in all 8 symmetries, reports the
+ * estimated 68000 cycles (LOGIC_COST model) of setting a puzzle up and checking
+ * an answer, and the ROM bytes per puzzle, and writes src/puzzle_tables.c /
+ * inc/puzzle_tables.h.
+ *
+ * Build (from the repository root):
+ *   gcc -O2 -pthread -DLOGIC_COST_MODEL -Iinc -Itools/host -o puzzle_gen tools/puzzle_gen.c src/puzzles.c src/game_logic.c src/policy_tables.c
+ *
+ * Usage: puzzle_gen [-t threads] [-n most moves to win] [-r timing runs] [-o repo root]
+ **/
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <genesis.h>
+#include <game_logic.h>
+#include <puzzles.h>
+
+#define CODES 19683
+#define MAX_PUZZLES 4096
+// exact values here: a win in n plies is SOLVE_WIN - n, a loss -(SOLVE_WIN - n)
+#define SOLVE_WIN 20
+
+typedef struct
+{
+    u16 code;
+    u8 win_in;
+    u8 length;
+    u8 moves[PUZZLE_MAX_LINE];
+} FoundPuzzle;
+
+typedef struct
+{
+    int index;
+    s8 values[2][CODES];    // [player == CROSS][squares as base 3, square 0 lowest]
+    long positions;
+    long nodes;
+    FoundPuzzle found[MAX_PUZZLES];
+    int found_count;
+} Worker;
+
+static int thread_count;
+static int max_win_in = PUZZLE_MAX_WIN_IN;
+static int powers[9];
+
+static FoundPuzzle puzzles[MAX_PUZZLES];
+static int puzzle_count;
+static u32 packed_boards[MAX_PUZZLES];
+static u16 packed_lines[MAX_PUZZLES];
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// solver
+/////////////////////////////////////////////////////////////////////////////////////
+
+static bool makesLine(const u8* squares, int square)
+{
+    for (int l=0; l<8; l++)
+    {
+        if (!(square_lines[square] & (1 << l))) continue;
+        const u8* line = winning_lines[l];
+        if ((squares[line[0]] == squares[square]) && (squares[line[1]] == squares[square]) && (squares[line[2]] == squares[square])) return TRUE;
+    }
+    return FALSE;
+}
+
+static s8 solve(Worker* w, u8* squares, u8 player, int empties, int code);
+
+static s8 scoreMove(Worker* w, u8* squares, int square, u8 player, int empties, int code)
+{
+    s8 score;
+
+    w->nodes++;
+    squares[square] = player;
+    if (makesLine(squares, square)) score = SOLVE_WIN - 1;
+    else if (empties == 1) score = 0;
+    else
+    {
+        // one ply further from the end for this side
+        s8 value = solve(w, squares, player == CROSS ? NOUGHT : CROSS, empties - 1, code + player * powers[square]);
+        score = value > 0 ? -(value - 1) : value < 0 ? -(value + 1) : 0;
+    }
+    squares[square] = EMPTY;
+    return score;
+}
+
+static s8 solve(Worker* w, u8* squares, u8 player, int empties, int code)
+{
+    s8* value = &w->values[player == CROSS][code];
+    if (*value != POSITION_UNKNOWN) return *value;
+
+    s8 best = -SOLVE_WIN;
+    for (int i=0; i<9; i++)
+    {
+        if (squares[i] != EMPTY) continue;
+        s8 score = scoreMove(w, squares, i, player, empties, code);
+        if (score > best) best = score;
+    }
+    *value = best;
+    return best;
+}
+
+// the line from a won position - FALSE if CROSS has more than one best move anywhere on it
+static bool findLine(Worker* w, const u8* start, int empties, int code, FoundPuzzle* found)
+{
+    u8 squares[9];
+    u8 player = CROSS;
+
+    memcpy(squares, start, 9);
+    found->length = 0;
+    while (TRUE)
+    {
+        s8 best = -SOLVE_WIN - 1;
+        int move = -1;
+        int count = 0;
+        for (int i=0; i<9; i++)
+        {
+            if (squares[i] != EMPTY) continue;
+            s8 score = scoreMove(w, squares, i, player, empties, code);
+            if (score > best)
+            {
+                best = score;
+                move = i;
+                count = 1;
+            }
+            else if (score == best) count++;
+        }
+
+        if ((player == CROSS) && (count != 1)) return FALSE;
+        found->moves[found->length++] = move;
+        if ((player == CROSS) && (best == SOLVE_WIN - 1)) return TRUE;
+
+        squares[move] = player;
+        code += player * powers[move];
+        empties--;
+        player = player == CROSS ? NOUGHT : CROSS;
+    }
+}
+
+// TRUE for the smallest canonicalPosition() code of a position, the one looked at for all its symmetries
+static bool isCanonical(const u8* squares, int code)
+{
+    for (int t=1; t<8; t++)
+    {
+        int other = 0;
+        for (int i=0; i<9; i++)
+        {
+            u8 state = squares[board_symmetries[t][i]];
+            other = other * 3 + (state == EMPTY ? 0 : state == CROSS ? 1 : 2);
+        }
+        if (other < code) return FALSE;
+    }
+    return TRUE;
+}
+
+static void* generateWorker(void* arg)
+{
+    Worker* w = arg;
+
+    memset(w->values, POSITION_UNKNOWN, sizeof(w->values));
+    w->positions = 0;
+    w->nodes = 0;
+    w->found_count = 0;
+
+    // canonicalPosition() codes with CROSS to move - square 0 is the top digit, 1 CROSS, 2 NOUGHT
+    for (int code=w->index; code<CODES; code+=thread_count)
+    {
+        u8 squares[9];
+        int crosses = 0;
+        int noughts = 0;
+        int value_code = 0;
+
+        for (int i=8, c=code; i>=0; i--, c/=3)
+        {
+            squares[i] = c % 3 == 0 ? EMPTY : c % 3 == 1 ? CROSS : NOUGHT;
+            if (squares[i] == CROSS) crosses++;
+            if (squares[i] == NOUGHT) noughts++;
+            value_code += squares[i] * powers[i];
+        }
+
+        // CROSS to move in a game either side started, not over, and one of each set of symmetries
+        if ((crosses != noughts) && (noughts != crosses + 1)) continue;
+        if (crosses + noughts == 9) continue;
+        bool over = FALSE;
+        for (int i=0; i<9; i++) over |= (squares[i] != EMPTY) && makesLine(squares, i);
+        if (over || !isCanonical(squares, code)) continue;
+
+        w->positions++;
+        int empties = 9 - crosses - noughts;
+        s8 value = solve(w, squares, CROSS, empties, value_code);
+        if ((value <= 0) || (SOLVE_WIN - value > max_win_in * 2 - 1)) continue;
+
+        FoundPuzzle* found = &w->found[w->found_count];
+        found->code = code;
+        found->win_in = (SOLVE_WIN - value + 1) / 2;
+        if (findLine(w, squares, empties, value_code, found)) w->found_count++;
+    }
+    return NULL;
+}
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int comparePuzzles(const void* a, const void* b)
+{
+    const FoundPuzzle* x = a;
+    const FoundPuzzle* y = b;
+    if (x->win_in != y->win_in) return x->win_in - y->win_in;
+    return x->code - y->code;
+}
+
+// the whole generation on threads workers, best time of runs - fills puzzles[]
+static void generate(int threads, int runs, Worker* workers)
+{
+    pthread_t handles[threads];
+    double best = 0;
+    long positions = 0;
+    long nodes = 0;
+
+    thread_count = threads;
+    for (int run=0; run<runs; run++)
+    {
+        double start = now();
+        for (int t=0; t<threads; t++)
+        {
+            workers[t].index = t;
+            pthread_create(&handles[t], NULL, generateWorker, &workers[t]);
+        }
+        for (int t=0; t<threads; t++) pthread_join(handles[t], NULL);
+        double elapsed = now() - start;
+        if ((run == 0) || (elapsed < best)) best = elapsed;
+    }
+
+    puzzle_count = 0;
+    for (int t=0; t<threads; t++)
+    {
+        positions += workers[t].positions;
+        nodes += workers[t].nodes;
+        memcpy(&puzzles[puzzle_count], workers[t].found, workers[t].found_count * sizeof(FoundPuzzle));
+        puzzle_count += workers[t].found_count;
+    }
+    qsort(puzzles, puzzle_count, sizeof(FoundPuzzle), comparePuzzles);
+
+    printf("%2d threads: %ld positions, %ld solver nodes in %.2f ms - %.0f positions/s, %.1fM nodes/s\n", threads, positions, nodes,
+           best * 1e3, positions / best, nodes / best / 1e6);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// packing and checks
+/////////////////////////////////////////////////////////////////////////////////////
+
+static void pack()
+{
+    for (int p=0; p<puzzle_count; p++)
+    {
+        FoundPuzzle* found = &puzzles[p];
+        u32 board = 0;
+        u32 moves = 0;
+
+        // back from the code - 1 CROSS, 2 NOUGHT - to 2 bit SQUARE_STATE values
+        for (int i=8, c=found->code; i>=0; i--, c/=3)
+        {
+            u32 state = c % 3 == 0 ? EMPTY : c % 3 == 1 ? CROSS : NOUGHT;
+            board |= state << (i * 2);
+        }
+        for (int m=PUZZLE_MAX_LINE - 1; m>=0; m--) moves = (moves << 4) | (m < found->length ? found->moves[m] : 15);
+
+        packed_boards[p] = board | ((u32)(found->win_in - 1) << PUZZLE_WIN_IN_SHIFT) | ((moves & 0xFFF) << PUZZLE_MOVES_SHIFT);
+        packed_lines[p] = moves >> 12;
+    }
+}
+
+// play every line through src/puzzles.c in every symmetry - the game logic has to see the win on the last move and not before
+static int checkPuzzles(u32* setup_max, u32* check_max)
+{
+    int errors = 0;
+
+    game_rules = RULES_STANDARD;
+    *setup_max = 0;
+    *check_max = 0;
+    for (int p=0; p<puzzle_count; p++)
+    {
+        for (int t=0; t<8; t++)
+        {
+            Puzzle puzzle;
+            GameBoard board;
+
+            logic_cycles = 0;
+            decodePuzzle(packed_boards[p], packed_lines[p], t, &puzzle);
+            setupPuzzleBoard(&puzzle, &board);
+            if (logic_cycles > *setup_max) *setup_max = logic_cycles;
+            if ((puzzle.win_in != puzzles[p].win_in) || testWin(&board)) errors++;
+
+            bool won = FALSE;
+            for (int step=0; (step < puzzle.win_in) && !won; step++)
+            {
+                int square = puzzle.moves[puzzle.step];
+                if (board.squares[square] != EMPTY)
+                {
+                    errors++;
+                    break;
+                }
+
+                // every other square has to be turned down
+                for (int i=0; i<9; i++)
+                {
+                    if ((i == square) || (board.squares[i] != EMPTY)) continue;
+                    if (checkPuzzleMove(&puzzle, i)) errors++;
+                }
+
+                logic_cycles = 0;
+                bool right = checkPuzzleMove(&puzzle, square);
+                int reply = puzzleReply(&puzzle);
+                if (logic_cycles > *check_max) *check_max = logic_cycles;
+                if (!right) errors++;
+
+                won = placePiece(&board, square);
+                if (won != (reply < 0)) errors++;
+                if (won) break;
+
+                nextPlayer(&board);
+                if ((board.squares[reply] != EMPTY) || placePiece(&board, reply)) errors++;
+                nextPlayer(&board);
+            }
+            if (!won) errors++;
+        }
+    }
+    return errors;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// export
+/////////////////////////////////////////////////////////////////////////////////////
+
+static FILE* openOutput(const char* root, const char* name)
+{
+    char path[512];
+
+    snprintf(path, sizeof(path), "%s/%s", root, name);
+    FILE* f = fopen(path, "w");
+    if (!f)
+    {
+        perror(path);
+        exit(1);
+    }
+    fprintf(f, "/**\n * Tic-Tac-Toe\n * \"Win in N\" puzzles - generated by tools/puzzle_gen.c, do not edit\n **/\n");
+    return f;
+}
+
+static void writeTables(const char* root)
+{
+    int first[PUZZLE_MAX_WIN_IN + 1];
+
+    for (int n=0, p=0; n<=PUZZLE_MAX_WIN_IN; n++)
+    {
+        while ((p < puzzle_count) && (puzzles[p].win_in <= n)) p++;
+        first[n] = p;
+    }
+
+    FILE* f = openOutput(root, "inc/puzzle_tables.h");
+    fprintf(f, "#ifndef _PUZZLE_TABLES_H_\n#define _PUZZLE_TABLES_H_\n\n#include <genesis.h>\n#include <puzzles.h>\n\n");
+    fprintf(f, "#define PUZZLE_COUNT %d\n\n", puzzle_count);
+    fprintf(f, "// index of the first puzzle won in 1..PUZZLE_MAX_WIN_IN moves, then PUZZLE_COUNT\n");
+    fprintf(f, "extern const u16 puzzle_first[PUZZLE_MAX_WIN_IN + 1];\n\n");
+    fprintf(f, "// packed as in puzzles.h, by N then position\n");
+    fprintf(f, "extern const u32 puzzle_boards[PUZZLE_COUNT];\nextern const u16 puzzle_lines[PUZZLE_COUNT];\n\n");
+    fprintf(f, "#endif // _PUZZLE_TABLES_H_\n");
+    fclose(f);
+
+    f = openOutput(root, "src/puzzle_tables.c");
+    fprintf(f, "#include <genesis.h>\n#include <puzzle_tables.h>\n\n");
+    fprintf(f, "const u16 puzzle_first[PUZZLE_MAX_WIN_IN + 1] = {");
+    for (int n=0; n<PUZZLE_MAX_WIN_IN; n++) fprintf(f, "%s%d", n ? ", " : " ", first[n]);
+    fprintf(f, ", PUZZLE_COUNT };\n\n");
+    fprintf(f, "const u32 puzzle_boards[PUZZLE_COUNT] = {");
+    for (int p=0; p<puzzle_count; p++) fprintf(f, "%s%s0x%08X", p ? "," : "", p % 8 ? " " : "\n    ", packed_boards[p]);
+    fprintf(f, "\n};\n\n");
+    fprintf(f, "const u16 puzzle_lines[PUZZLE_COUNT] = {");
+    for (int p=0; p<puzzle_count; p++) fprintf(f, "%s%s0x%04X", p ? "," : "", p % 12 ? " " : "\n    ", packed_lines[p]);
+    fprintf(f, "\n};\n");
+    fclose(f);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// main
+/////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv)
+{
+    int threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int runs = 20;
+    const char* root = ".";
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:n:r:o:")) != -1)
+    {
+        if (opt == 't') threads = atoi(optarg);
+        else if (opt == 'n') max_win_in = atoi(optarg);
+        else if (opt == 'r') runs = atoi(optarg);
+        else if (opt == 'o') root = optarg;
+        else
+        {
+            fprintf(stderr, "usage: %s [-t threads] [-n most moves to win] [-r timing runs] [-o repo root]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (threads < 1) threads = 1;
+    if (runs < 1) runs = 1;
+    if ((max_win_in < 1) || (max_win_in > PUZZLE_MAX_WIN_IN)) max_win_in = PUZZLE_MAX_WIN_IN;
+
+    powers[0] = 1;
+    for (int i=1; i<9; i++) powers[i] = powers[i - 1] * 3;
+
+    Worker* workers = malloc(sizeof(Worker) * threads);
+    printf("positions with CROSS to move, one per symmetry, best of %d runs\n", runs);
+    generate(1, runs, workers);
+    if (threads > 1) generate(threads, runs, workers);
+    free(workers);
+
+    int counts[PUZZLE_MAX_WIN_IN + 1] = { 0 };
+    for (int p=0; p<puzzle_count; p++) counts[puzzles[p].win_in]++;
+    printf("\n%d puzzles:", puzzle_count);
+    for (int n=1; n<=max_win_in; n++) printf(" %d win in %d%s", counts[n], n, n < max_win_in ? "," : "\n");
+
+    pack();
+    u32 setup_max, check_max;
+    int errors = checkPuzzles(&setup_max, &check_max);
+    printf("checked in all 8 symmetries: %d errors\n", errors);
+    printf("68000 cycles (LOGIC_COST): set up a puzzle %u max, check an answer and reply %u max\n", setup_max, check_max);
+    if (errors) return 1;
+
+    int bytes = puzzle_count * (sizeof(u32) + sizeof(u16)) + (PUZZLE_MAX_WIN_IN + 1) * sizeof(u16);
+    writeTables(root);
+    printf("wrote %d puzzles, %d bytes of rom tables - %.2f bytes per puzzle\n", puzzle_count, bytes, (double)bytes / puzzle_count);
+    return 0;
+}
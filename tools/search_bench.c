@@ -0,0 +1,244 @@
+/**
+ * Tic-Tac-Toe
+ * Cost and strength of the cpu search at each difficulty
+ *
+ * Runs searchMove on every reachable, unfinished position and reports the nodes
+ * visited and the estimated 68000 cycles (LOGIC_COST model in game_logic.c), so
+ * the worst case of each difficulty can be read off against the bound the menu
+ * shows (searchWorstCase), then plays each difficulty
+ * against the reference player of tools/policy_train.c (a perfect move 3 times in
+ * 4, a random move otherwise) and against a perfect player. A sweep of node caps
+ * at full depth shows the worst case growing no faster than the cap, and the cap
+ * from which the search stops losing.
+ *
+ * Every search is checked against searchCycles for the nodes it visited (the
+ * search_cycles / node_cycles of the standard rules in game_logic.c); the bench
+ * exits non-zero if any goes over, so the constants have to be measured again
+ * after a change to the search.
+ *
+ * Build (from the repository root):
+ *   gcc -O2 -DLOGIC_COST_MODEL -Iinc -Itools/host -o search_bench tools/search_bench.c src/game_logic.c src/policy_tables.c
+ *
+ * Usage: search_bench [games per match] [max nodes] [max depth] [noise]
+ *
+ * Given a max nodes (and optionally depth / noise) a custom level is benched
+ * alongside the presets.
+ **/
+#include <stdio.h>
+#include <string.h>
+#include <genesis.h>
+#include <game_logic.h>
+
+#define MAX_POSITIONS 6000
+#define REFERENCE_SKILL 75
+
+typedef struct
+{
+    const char* name;
+    SearchLimits limits;
+} Level;
+
+static GameBoard positions[MAX_POSITIONS];
+static int position_count;
+static u8 seen[19683];
+
+static u32 cycles[MAX_POSITIONS];
+static int over_bound;
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// positions
+/////////////////////////////////////////////////////////////////////////////////////
+
+static int positionCode(GameBoard* board)
+{
+    int code = 0;
+    for (int i=0; i<9; i++) code = code * 3 + board->squares[i];
+    return code;
+}
+
+// every reachable position with a move to make
+static void enumerate(GameBoard* board)
+{
+    int code = positionCode(board);
+    if (seen[code]) return;
+    seen[code] = 1;
+    positions[position_count++] = *board;
+
+    for (int i=0; i<9; i++)
+    {
+        if (board->squares[i] != EMPTY) continue;
+
+        GameBoard next = *board;
+        if (placePiece(&next, i) || (next.moves_remaining == 0)) continue;
+        nextPlayer(&next);
+        enumerate(&next);
+    }
+}
+
+static int compareU32(const void* a, const void* b)
+{
+    u32 x = *(const u32*)a;
+    u32 y = *(const u32*)b;
+    return (x > y) - (x < y);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// players
+/////////////////////////////////////////////////////////////////////////////////////
+
+static int perfectMove(GameBoard* board)
+{
+    s8 values[9];
+    s8 best = -10;
+    int count = 0;
+
+    for (int i=0; i<9; i++)
+    {
+        values[i] = board->squares[i] == EMPTY ? moveValue(board, i) : -10;
+        if (values[i] > best) best = values[i];
+    }
+
+    // at random between equals, so every line of perfect play gets tried
+    for (int i=0; i<9; i++) if (values[i] == best) count++;
+    int r = random() % count;
+    for (int i=0; i<9; i++) if ((values[i] == best) && (r-- == 0)) return i;
+    return -1;
+}
+
+static int referenceMove(GameBoard* board)
+{
+    return (random() % 100) < REFERENCE_SKILL ? perfectMove(board) : randomMove(board);
+}
+
+// returns the winner, EMPTY for a draw - the cpu is NOUGHT, the starting player alternates as on the console
+static enum SQUARE_STATE playGame(SearchLimits* limits, int (*opponent)(GameBoard*), enum SQUARE_STATE first)
+{
+    GameBoard board;
+    clearBoard(&board);
+    board.current_player = first;
+
+    while (TRUE)
+    {
+        int square;
+        if (board.current_player == NOUGHT)
+        {
+            SearchContext context;
+            context.limits = *limits;
+            square = searchMove(&context, &board);
+        }
+        else
+        {
+            square = opponent(&board);
+        }
+
+        if (placePiece(&board, square)) return board.current_player;
+        if (board.moves_remaining == 0) return EMPTY;
+        nextPlayer(&board);
+    }
+}
+
+static void playMatch(SearchLimits* limits, int (*opponent)(GameBoard*), int games, int* results)
+{
+    results[0] = results[1] = results[2] = 0;
+    for (int game=0; game<games; game++)
+    {
+        enum SQUARE_STATE winner = playGame(limits, opponent, game & 1 ? CROSS : NOUGHT);
+        results[winner == CROSS ? 0 : winner == EMPTY ? 1 : 2]++;
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// report
+/////////////////////////////////////////////////////////////////////////////////////
+
+// searches every position, returns the most nodes visited, fills cycles[] and counts the searches over searchCycles
+static int measure(SearchLimits* limits, int* over)
+{
+    int max_nodes = 0;
+    *over = 0;
+
+    for (int i=0; i<position_count; i++)
+    {
+        SearchContext context;
+        GameBoard board = positions[i];
+
+        srandom(i);
+        context.limits = *limits;
+        logic_cycles = 0;
+        searchMove(&context, &board);
+        cycles[i] = logic_cycles;
+        if (context.nodes > max_nodes) max_nodes = context.nodes;
+        if (logic_cycles > searchCycles(context.nodes)) (*over)++;
+    }
+
+    qsort(cycles, position_count, sizeof(u32), compareU32);
+    return max_nodes;
+}
+
+static void benchLevel(Level* level, int games)
+{
+    int reference[3];
+    int perfect[3];
+    int over;
+
+    int max_nodes = measure(&level->limits, &over);
+    u32 p50 = cycles[position_count / 2];
+    u32 max = cycles[position_count - 1];
+    u32 bound = searchWorstCase(&level->limits);
+    if (max > bound) over++;
+    over_bound += over;
+
+    srandom(1);
+    playMatch(&level->limits, referenceMove, games, reference);
+    playMatch(&level->limits, perfectMove, games, perfect);
+
+    printf("%-8s %5u %5u %5u   %5d %8u %8u %8u %5d   %5.1f%% %5.1f%% %5.1f%%   %5.1f%%\n", level->name,
+           level->limits.max_nodes, level->limits.max_depth, level->limits.noise, max_nodes, p50, max, bound, over,
+           reference[0] * 100.0 / games, reference[1] * 100.0 / games, reference[2] * 100.0 / games, perfect[0] * 100.0 / games);
+}
+
+int main(int argc, char** argv)
+{
+    int games = argc > 1 ? atoi(argv[1]) : 20000;
+    Level levels[5] = {
+        { "easy", default_difficulty_limits[CPU_EASY] },
+        { "medium", default_difficulty_limits[CPU_MEDIUM] },
+        { "hard", default_difficulty_limits[CPU_HARD] },
+    };
+    int level_count = 3;
+
+    if (argc > 2)
+    {
+        SearchLimits custom = { atoi(argv[2]), argc > 3 ? atoi(argv[3]) : 9, argc > 4 ? atoi(argv[4]) : 0 };
+        levels[level_count++] = (Level){ "custom", custom };
+    }
+
+    // the perfect player plays from the exact values in policy_tables.c
+    GameBoard empty;
+    clearBoard(&empty);
+    empty.current_player = CROSS;
+    enumerate(&empty);
+    empty.current_player = NOUGHT;
+    enumerate(&empty);
+    printf("%d positions with a move to make, %d games per match\n\n", position_count, games);
+
+    printf("%-8s %5s %5s %5s   %5s %8s %8s %8s %5s   %-20s   %s\n", "", "nodes", "depth", "noise", "used", "p50 cyc", "max cyc", "bound",
+           "over", "reference W/D/L", "perfect wins");
+    for (int i=0; i<level_count; i++) benchLevel(&levels[i], games);
+
+    // full depth, no noise - only the node cap limits the search
+    printf("\nnode cap sweep:\n");
+    for (int cap=1; cap<=4096; cap*=2)
+    {
+        char name[16];
+        snprintf(name, sizeof(name), "cap %d", cap);
+        Level level = { name, { cap, 9, 0 } };
+        benchLevel(&level, games / 4);
+    }
+
+    if (over_bound) printf("\n%d searches over the worst case of game_logic.c - measure search_cycles / node_cycles again\n", over_bound);
+    return over_bound ? 1 : 0;
+}
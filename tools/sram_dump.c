@@ -0,0 +1,39 @@
+/**
+ * Tic-Tac-Toe
+ * Reading SRAM save files on the host
+ **/
+#include <genesis.h>
+#include "sram_dump.h"
+
+const SramLayout sram_layouts[SRAM_LAYOUTS] = { { "byte", 1, 0 }, { "word odd", 2, 1 }, { "word even", 2, 0 } };
+
+
+bool sramHas(long size, const SramLayout* layout, int offset, int bytes)
+{
+    return (long)(offset + bytes - 1) * layout->stride + layout->offset < size;
+}
+
+u32 readSram(const u8* data, long size, const SramLayout* layout, int offset, int bytes)
+{
+    u32 value = 0;
+    for (int i=0; i<bytes; i++)
+    {
+        long at = (long)(offset + i) * layout->stride + layout->offset;
+        value = (value << 8) | (at < size ? data[at] : 0);
+    }
+    return value;
+}
+
+bool sramFillerConstant(const u8* data, long size, const SramLayout* layout, int offset, int bytes)
+{
+    if (layout->stride == 1) return TRUE;
+
+    // the other byte of each word
+    long first = (long)offset * 2 + (1 - layout->offset);
+    for (int i=0; i<bytes; i++)
+    {
+        long at = (long)(offset + i) * 2 + (1 - layout->offset);
+        if ((at >= size) || (data[at] != data[first])) return FALSE;
+    }
+    return TRUE;
+}
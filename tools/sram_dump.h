@@ -0,0 +1,35 @@
+/**
+ * Tic-Tac-Toe
+ * Reading SRAM save files on the host
+ *
+ * SGDK puts the SRAM on the odd bytes of the cartridge bus, and SRAM_writeXXX(offset)
+ * takes the offset of the byte within the SRAM. Save files come either with one byte
+ * per SRAM byte, or as the bus sees it, the SRAM bytes in every other byte (odd, or
+ * even from some dumpers) and filler in the rest. Nothing here copies the file - the
+ * values are read from wherever it is held, a mapping or a buffer.
+ **/
+#ifndef _SRAM_DUMP_H_
+#define _SRAM_DUMP_H_
+
+#include <genesis.h>
+
+#define SRAM_LAYOUTS 3
+
+typedef struct
+{
+    const char* name;
+    int stride;
+    int offset;
+} SramLayout;
+
+// byte, word with the SRAM on the odd bytes, word with it on the even bytes
+extern const SramLayout sram_layouts[SRAM_LAYOUTS];
+
+// TRUE if SRAM bytes offset..offset + bytes - 1 are in a file of size bytes under layout
+bool sramHas(long size, const SramLayout* layout, int offset, int bytes);
+// big endian, as SRAM_writeLong / SRAM_writeWord put them - 0 past the end of the file
+u32 readSram(const u8* data, long size, const SramLayout* layout, int offset, int bytes);
+// TRUE if the bytes between the SRAM ones are all the same over offset..offset + bytes - 1 (always for the byte layout)
+bool sramFillerConstant(const u8* data, long size, const SramLayout* layout, int offset, int bytes);
+
+#endif // _SRAM_DUMP_H_
@@ -0,0 +1,451 @@
+/**
+ * Tic-Tac-Toe
+ * Statistics over SRAM save files
+ *
+ * Adds up the scores kept in SRAM (games played, won and lost against each
+ * OPPONENT_TYPE under the standard rules - the other variants are kept after
+ * the puzzles, see scoreSram in src/main.c) over any number of save files,
+ * given as files or directories searched for *.srm. The file list is split into
+ * one run of consecutive files per thread; each file is mapped, read in place
+ * and let go, so every file is read once and none is copied.
+ *
+ * The layout of each file (tools/sram_dump.c) is worked out as it is read:
+ * under the right one won + lost is at most played for every opponent, and for
+ * the word layouts the bytes in between are the same filler all through the
+ * file. Small counts pass under more than one layout; then a word layout is
+ * taken over the byte one, unless only its reading has counters over 0xFFFF.
+ * A file is
+ *   ok         a layout passes
+ *   blank      the scores are all 0xFF, as SRAM that was never written
+ *   ambiguous  both word layouts pass and read different scores (use -l)
+ *   invalid    no layout passes
+ *   short      too small to hold the scores
+ *   unreadable cannot be opened or mapped
+ * and only ok files go into the totals.
+ *
+ * Prints the totals per opponent as CSV on stdout, and files and bytes per
+ * second on stderr; exits with 1 if any file was neither ok nor blank.
+ *
+ * Build (from the repository root):
+ *   gcc -O2 -pthread -Iinc -Itools/host -o srm_stats tools/srm_stats.c tools/sram_dump.c
+ *
+ * Usage: srm_stats [-t threads] [-l byte|word-odd|word-even] [-f per file csv] <file or directory>...
+ **/
+#define _XOPEN_SOURCE 700
+#include <fcntl.h>
+#include <ftw.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <genesis.h>
+#include <game_logic.h>
+#include "sram_dump.h"
+
+typedef unsigned long long u64;
+
+#define OPPONENTS 4
+// played, won, lost per opponent, as the ROM lays them out
+#define SCORE_LONGS (OPPONENTS * 3)
+#define SCORE_BYTES (SCORE_LONGS * 4)
+
+enum FILE_STATUS { FILE_OK, FILE_BLANK, FILE_AMBIGUOUS, FILE_INVALID, FILE_SHORT, FILE_UNREADABLE, FILE_STATUSES };
+
+// one row of the totals per column, one column per opponent
+enum TOTAL { TOTAL_FILES, TOTAL_FILES_PLAYED, TOTAL_GAMES, TOTAL_PLAYER_WINS, TOTAL_OPPONENT_WINS, TOTAL_DRAWS,
+             TOTAL_MAX_GAMES, TOTALS };
+
+static const char* const status_names[FILE_STATUSES] = { "ok", "blank", "ambiguous", "invalid", "short", "unreadable" };
+static const char* const opponent_names[OPPONENTS] = { "player 2", "cpu easy", "cpu medium", "cpu hard" };
+static const char* const layout_options[SRAM_LAYOUTS] = { "byte", "word-odd", "word-even" };
+
+typedef struct
+{
+    char* data;
+    size_t length;
+    size_t size;
+} TextBuffer;
+
+typedef struct
+{
+    pthread_t thread;
+    int first;
+    int last;
+    u64 totals[TOTALS][OPPONENTS];
+    u32 statuses[FILE_STATUSES];
+    u64 bytes;
+    TextBuffer rows;
+} Worker;
+
+static char** paths;
+static int path_count;
+static int path_size;
+static int forced_layout = -1;
+static bool per_file;
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// file list
+/////////////////////////////////////////////////////////////////////////////////////
+
+static void addPath(const char* path)
+{
+    if (path_count == path_size)
+    {
+        path_size = path_size ? path_size * 2 : 1024;
+        paths = realloc(paths, sizeof(char*) * path_size);
+    }
+    paths[path_count++] = strdup(path);
+}
+
+static int addSaveFile(const char* path, const struct stat* st, int type, struct FTW* ftw)
+{
+    (void)st;
+    (void)ftw;
+    size_t length = strlen(path);
+    if ((type == FTW_F) && (length > 4) && (strcmp(path + length - 4, ".srm") == 0)) addPath(path);
+    return 0;
+}
+
+static int comparePaths(const void* a, const void* b)
+{
+    return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+// files are taken as given, directories searched for *.srm - in name order either way, so runs read the same
+static void findSaveFiles(const char* path)
+{
+    struct stat st;
+    if ((stat(path, &st) == 0) && S_ISDIR(st.st_mode))
+    {
+        int first = path_count;
+        nftw(path, addSaveFile, 32, FTW_PHYS);
+        qsort(paths + first, path_count - first, sizeof(char*), comparePaths);
+    }
+    else addPath(path);
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// decoding
+/////////////////////////////////////////////////////////////////////////////////////
+
+// TRUE if the scores read under layout could have been written by the ROM - for the word layouts the filler
+// has to be the same all through the file, which a byte dump only manages if every other byte of it is
+static bool readScores(const u8* data, long size, const SramLayout* layout, u32* scores)
+{
+    if (!sramHas(size, layout, 0, SCORE_BYTES)) return FALSE;
+    if (!sramFillerConstant(data, size, layout, 0, size / layout->stride)) return FALSE;
+
+    for (int i=0; i<SCORE_LONGS; i++) scores[i] = readSram(data, size, layout, i * 4, 4);
+    for (int o=0; o<OPPONENTS; o++)
+    {
+        if ((u64)scores[o * 3 + 1] + scores[o * 3 + 2] > scores[o * 3]) return FALSE;
+    }
+    return TRUE;
+}
+
+static bool blankScores(const u8* data, long size, const SramLayout* layout)
+{
+    for (int i=0; i<SCORE_LONGS; i++)
+    {
+        if (readSram(data, size, layout, i * 4, 4) != 0xFFFFFFFF) return FALSE;
+    }
+    return TRUE;
+}
+
+// a byte dump read as a word one puts the low bytes of two counters into one, 0x10000 times too big
+static bool wideScores(const u32* scores)
+{
+    for (int i=0; i<SCORE_LONGS; i++)
+    {
+        if (scores[i] > 0xFFFF) return TRUE;
+    }
+    return FALSE;
+}
+
+static enum FILE_STATUS decodeScores(const u8* data, long size, int* layout, u32* scores)
+{
+    int first = forced_layout >= 0 ? forced_layout : 0;
+    int last = forced_layout >= 0 ? forced_layout : SRAM_LAYOUTS - 1;
+    bool fits = FALSE;
+    bool blank = TRUE;
+    bool byte_passed = FALSE;
+    bool ambiguous = FALSE;
+    u32 byte_scores[SCORE_LONGS];
+
+    *layout = -1;
+    for (int l=first; l<=last; l++)
+    {
+        u32 read[SCORE_LONGS];
+        if (!sramHas(size, &sram_layouts[l], 0, SCORE_BYTES)) continue;
+        fits = TRUE;
+        blank &= blankScores(data, size, &sram_layouts[l]);
+        if (!readScores(data, size, &sram_layouts[l], read)) continue;
+
+        if (sram_layouts[l].stride == 1)
+        {
+            byte_passed = TRUE;
+            memcpy(byte_scores, read, sizeof(read));
+        }
+        // both word layouts only pass with a constant file, whose two readings are then the same or guesswork
+        else if (*layout >= 0) ambiguous |= memcmp(scores, read, sizeof(read)) != 0;
+        else
+        {
+            *layout = l;
+            memcpy(scores, read, sizeof(read));
+        }
+    }
+
+    if (!fits) return FILE_SHORT;
+    if (blank) return FILE_BLANK;
+    if (ambiguous) return FILE_AMBIGUOUS;
+
+    // the filler makes a word layout the likelier one, unless its scores look like a byte dump read as words
+    if (byte_passed && ((*layout < 0) || (wideScores(scores) && !wideScores(byte_scores))))
+    {
+        *layout = 0;
+        memcpy(scores, byte_scores, sizeof(byte_scores));
+    }
+    return *layout >= 0 ? FILE_OK : FILE_INVALID;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// workers
+/////////////////////////////////////////////////////////////////////////////////////
+
+static void appendRow(TextBuffer* buffer, const char* path, enum FILE_STATUS status, int layout, const u32* scores)
+{
+    // path, status, layout, then played, won, lost per opponent - quotes only doubled, paths are not otherwise escaped
+    if (buffer->size - buffer->length < strlen(path) * 2 + 256)
+    {
+        buffer->size = buffer->size * 2 + strlen(path) * 2 + 256;
+        buffer->data = realloc(buffer->data, buffer->size);
+    }
+
+    char* out = buffer->data + buffer->length;
+    *out++ = '"';
+    for (const char* c = path; *c; c++)
+    {
+        if (*c == '"') *out++ = '"';
+        *out++ = *c;
+    }
+    out += sprintf(out, "\",%s,%s", status_names[status], layout >= 0 ? layout_options[layout] : "");
+    for (int i=0; i<SCORE_LONGS; i++)
+    {
+        if (status == FILE_OK) out += sprintf(out, ",%u", scores[i]);
+        else *out++ = ',';
+    }
+    *out++ = '\n';
+    buffer->length = out - buffer->data;
+}
+
+static void addScores(Worker* worker, const u32* scores)
+{
+    for (int o=0; o<OPPONENTS; o++)
+    {
+        u32 played = scores[o * 3];
+        u32 won = scores[o * 3 + 1];
+        u32 lost = scores[o * 3 + 2];
+
+        // won is games the opponent (NOUGHT) took, lost the ones player 1 did
+        worker->totals[TOTAL_FILES][o]++;
+        worker->totals[TOTAL_FILES_PLAYED][o] += played != 0;
+        worker->totals[TOTAL_GAMES][o] += played;
+        worker->totals[TOTAL_PLAYER_WINS][o] += lost;
+        worker->totals[TOTAL_OPPONENT_WINS][o] += won;
+        worker->totals[TOTAL_DRAWS][o] += played - won - lost;
+        if (played > worker->totals[TOTAL_MAX_GAMES][o]) worker->totals[TOTAL_MAX_GAMES][o] = played;
+    }
+}
+
+static enum FILE_STATUS readSaveFile(Worker* worker, const char* path, int* layout, u32* scores)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return FILE_UNREADABLE;
+
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || !S_ISREG(st.st_mode))
+    {
+        close(fd);
+        return FILE_UNREADABLE;
+    }
+    if (st.st_size == 0)
+    {
+        close(fd);
+        return FILE_SHORT;
+    }
+
+    u8* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return FILE_UNREADABLE;
+
+    // the filler check reads the file through from the start
+    posix_madvise(data, st.st_size, POSIX_MADV_SEQUENTIAL);
+    enum FILE_STATUS status = decodeScores(data, st.st_size, layout, scores);
+    munmap(data, st.st_size);
+    worker->bytes += st.st_size;
+    return status;
+}
+
+static void* statsWorker(void* arg)
+{
+    Worker* worker = arg;
+
+    for (int f=worker->first; f<worker->last; f++)
+    {
+        u32 scores[SCORE_LONGS];
+        int layout = -1;
+        enum FILE_STATUS status = readSaveFile(worker, paths[f], &layout, scores);
+
+        worker->statuses[status]++;
+        if (status == FILE_OK) addScores(worker, scores);
+        if (per_file) appendRow(&worker->rows, paths[f], status, layout, scores);
+    }
+    return NULL;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// output
+/////////////////////////////////////////////////////////////////////////////////////
+
+static void printTotals(u64 totals[TOTALS][OPPONENTS])
+{
+    printf("opponent,files,files_played,games,player_wins,opponent_wins,draws,player_win_rate,max_games_per_file\n");
+    for (int o=0; o<=OPPONENTS; o++)
+    {
+        u64 row[TOTALS] = { 0 };
+        for (int t=0; t<TOTALS; t++)
+        {
+            if (o < OPPONENTS) row[t] = totals[t][o];
+            else if (t == TOTAL_MAX_GAMES) for (int p=0; p<OPPONENTS; p++) row[t] = totals[t][p] > row[t] ? totals[t][p] : row[t];
+            else for (int p=0; p<OPPONENTS; p++) row[t] += totals[t][p];
+        }
+        // a file counts once in the total, not once per opponent
+        if (o == OPPONENTS) row[TOTAL_FILES] = totals[TOTAL_FILES][0];
+
+        printf("%s,%llu,%llu,%llu,%llu,%llu,%llu,%.4f,%llu\n", o < OPPONENTS ? opponent_names[o] : "total",
+               row[TOTAL_FILES], row[TOTAL_FILES_PLAYED],
+               row[TOTAL_GAMES], row[TOTAL_PLAYER_WINS],
+               row[TOTAL_OPPONENT_WINS], row[TOTAL_DRAWS],
+               row[TOTAL_GAMES] ? (double)row[TOTAL_PLAYER_WINS] / row[TOTAL_GAMES] : 0.0,
+               row[TOTAL_MAX_GAMES]);
+    }
+}
+
+static bool writePerFile(const char* path, Worker* workers, int threads)
+{
+    FILE* f = fopen(path, "w");
+    if (!f)
+    {
+        perror(path);
+        return FALSE;
+    }
+
+    fprintf(f, "path,status,layout");
+    for (int o=0; o<OPPONENTS; o++) fprintf(f, ",%s played,%s won,%s lost", opponent_names[o], opponent_names[o], opponent_names[o]);
+    fprintf(f, "\n");
+    // the workers had consecutive runs of files, so this is file order
+    for (int w=0; w<threads; w++) fwrite(workers[w].rows.data, 1, workers[w].rows.length, f);
+    fclose(f);
+    return TRUE;
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// main
+/////////////////////////////////////////////////////////////////////////////////////
+
+static void usage(const char* name)
+{
+    fprintf(stderr, "usage: %s [-t threads] [-l byte|word-odd|word-even] [-f per file csv] <file or directory>...\n", name);
+}
+
+int main(int argc, char** argv)
+{
+    int threads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char* per_file_path = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:l:f:")) != -1)
+    {
+        if (opt == 't') threads = atoi(optarg);
+        else if (opt == 'f') per_file_path = optarg;
+        else if (opt == 'l')
+        {
+            for (int l=0; l<SRAM_LAYOUTS; l++) if (strcmp(optarg, layout_options[l]) == 0) forced_layout = l;
+            if (forced_layout < 0)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind == argc)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    per_file = per_file_path != NULL;
+
+    for (int i=optind; i<argc; i++) findSaveFiles(argv[i]);
+    if (threads < 1) threads = 1;
+    if (threads > path_count) threads = path_count ? path_count : 1;
+
+    double start = now();
+    Worker* workers = calloc(threads, sizeof(Worker));
+    for (int w=0; w<threads; w++)
+    {
+        workers[w].first = (long)path_count * w / threads;
+        workers[w].last = (long)path_count * (w + 1) / threads;
+        pthread_create(&workers[w].thread, NULL, statsWorker, &workers[w]);
+    }
+
+    u64 totals[TOTALS][OPPONENTS] = { { 0 } };
+    u32 statuses[FILE_STATUSES] = { 0 };
+    u64 bytes = 0;
+    for (int w=0; w<threads; w++)
+    {
+        pthread_join(workers[w].thread, NULL);
+        for (int o=0; o<OPPONENTS; o++)
+        {
+            for (int t=0; t<TOTALS; t++)
+            {
+                if (t == TOTAL_MAX_GAMES) totals[t][o] = workers[w].totals[t][o] > totals[t][o] ? workers[w].totals[t][o] : totals[t][o];
+                else totals[t][o] += workers[w].totals[t][o];
+            }
+        }
+        for (int s=0; s<FILE_STATUSES; s++) statuses[s] += workers[w].statuses[s];
+        bytes += workers[w].bytes;
+    }
+    double seconds = now() - start;
+
+    printTotals(totals);
+    bool written = per_file ? writePerFile(per_file_path, workers, threads) : TRUE;
+
+    fprintf(stderr, "%d files, %.1f MB in %.3f s on %d threads: %.0f files/s, %.1f MB/s\n", path_count, bytes / 1e6, seconds,
+            threads, seconds > 0 ? path_count / seconds : 0, seconds > 0 ? bytes / 1e6 / seconds : 0);
+    for (int s=0; s<FILE_STATUSES; s++) fprintf(stderr, "%s%s %u", s ? ", " : "", status_names[s], statuses[s]);
+    fprintf(stderr, "\n");
+
+    for (int w=0; w<threads; w++) free(workers[w].rows.data);
+    free(workers);
+    return (written && (statuses[FILE_OK] + statuses[FILE_BLANK] == (u32)path_count)) ? 0 : 1;
+}
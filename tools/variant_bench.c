@@ -0,0 +1,301 @@
+/**
+ * Tic-Tac-Toe
+ * Cost of each rule variant's line test and search against the standard rules
+ *
+ * game_logic.c builds the line test and the search once per RULE_VARIANT from
+ * inc/rule_variant.h. This builds the same template once more with the rules
+ * looked up at run time inside the loops (what a single shared search would
+ * do), and for each variant reports, over the positions of random games:
+ *
+ *   - estimated 68000 cycles (LOGIC_COST model) of testWin per move played
+ *   - cycles of a cpu move at each difficulty, p50 / max and per node, for the
+ *     specialised and the run time search, and max / the standard rules' max
+ *   - the worst case the menu shows for the variant (searchWorstCase), and the
+ *     specialised searches that went over searchCycles for the nodes they
+ *     visited - any at all and the bench exits non-zero
+ *   - host ns per node of both
+ *   - hard against easy, so the search is seen to play each variant
+ *
+ * Build (from the repository root):
+ *   gcc -O2 -DLOGIC_COST_MODEL -Iinc -Itools/host -o variant_bench tools/variant_bench.c src/game_logic.c src/policy_tables.c
+ *
+ * Usage: variant_bench [positions per variant] [games per match]
+ **/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <genesis.h>
+#include <game_logic.h>
+
+#define MAX_POSITIONS 20000
+
+static const char* variant_names[4] = { "standard", "misere", "wild", "numerical" };
+static const char* level_names[4] = { "", "easy", "medium", "hard" };
+
+static GameBoard positions[MAX_POSITIONS];
+static int position_count;
+static u32 cycles[MAX_POSITIONS];
+
+// the evaluations of game_logic.c
+s16 evaluateStandard(SearchContext* context, enum SQUARE_STATE player, int empties);
+s16 evaluateMisere(SearchContext* context, enum SQUARE_STATE player, int empties);
+s16 evaluateWild(SearchContext* context, enum SQUARE_STATE player, int empties);
+s16 evaluateNumerical(SearchContext* context, enum SQUARE_STATE player, int empties);
+u8 nextNumber(u16 numbers, s8 number);
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// the search with the rules looked up at run time
+/////////////////////////////////////////////////////////////////////////////////////
+
+// a switch on game_rules - a jump table on the 68000
+#define RULES_BRANCH_COST 40
+
+static bool genericLine(u8 a, u8 b, u8 c)
+{
+    if (game_rules == RULES_NUMERICAL) return a && b && c && (a + b + c == 15);
+    return (a == b) && (b == c);
+}
+
+static u8 genericFirstPiece(enum SQUARE_STATE player, u16 numbers, int empties)
+{
+    switch (game_rules)
+    {
+        case RULES_WILD: return CROSS;
+        case RULES_NUMERICAL: return nextNumber(numbers, empties & 1 ? -1 : 0);
+        default: return player;
+    }
+}
+
+static u8 genericNextPiece(u8 piece, u16 numbers)
+{
+    switch (game_rules)
+    {
+        case RULES_WILD: return piece == CROSS ? NOUGHT : 0;
+        case RULES_NUMERICAL: return nextNumber(numbers, piece);
+        default: return 0;
+    }
+}
+
+s16 evaluateGeneric(SearchContext* context, enum SQUARE_STATE player, int empties)
+{
+    LOGIC_COST(RULES_BRANCH_COST);
+    switch (game_rules)
+    {
+        case RULES_MISERE: return evaluateMisere(context, player, empties);
+        case RULES_WILD: return evaluateWild(context, player, empties);
+        case RULES_NUMERICAL: return evaluateNumerical(context, player, empties);
+        default: return evaluateStandard(context, player, empties);
+    }
+}
+
+#define RULES_NAME Generic
+#define RULES_LINE(a, b, c) genericLine(a, b, c)
+#define RULES_LINE_COST (80 + RULES_BRANCH_COST)
+#define RULES_LINE_LOSES (game_rules == RULES_MISERE)
+#define RULES_MIN_MOVES (game_rules <= RULES_MISERE ? 5 : 3)
+#define RULES_MAX_PIECES 5
+#define RULES_FIRST_PIECE(player, numbers, empties) genericFirstPiece(player, numbers, empties)
+#define RULES_NEXT_PIECE(piece, numbers) genericNextPiece(piece, numbers)
+#define RULES_PIECE_COST (40 + RULES_BRANCH_COST)
+#define RULES_NUMBERS (game_rules == RULES_NUMERICAL)
+#include <rule_variant.h>
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// positions
+/////////////////////////////////////////////////////////////////////////////////////
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compareU32(const void* a, const void* b)
+{
+    u32 x = *(const u32*)a;
+    u32 y = *(const u32*)b;
+    return (x > y) - (x < y);
+}
+
+// random move and piece for the side to move
+static int randomPieceMove(GameBoard* board, u8* piece)
+{
+    u8 pieces[5];
+    int count = 0;
+    for (u8 p = nextPiece(board, 0); p; p = nextPiece(board, p)) pieces[count++] = p;
+    *piece = pieces[random() % count];
+    return randomMove(board);
+}
+
+// the positions of random games under game_rules, with the testWin cycles of every move on the way
+static void collectPositions(int wanted, u32* test_total, u32* test_max, int* test_count)
+{
+    position_count = 0;
+    *test_total = 0;
+    *test_max = 0;
+    *test_count = 0;
+
+    while (position_count < wanted)
+    {
+        GameBoard board;
+        clearBoard(&board);
+        board.current_player = random() & 1 ? CROSS : NOUGHT;
+
+        while (position_count < wanted)
+        {
+            positions[position_count++] = board;
+
+            u8 piece;
+            int square = randomPieceMove(&board, &piece);
+            logic_cycles = 0;
+            bool line = placeMove(&board, square, piece);
+            *test_total += logic_cycles;
+            if (logic_cycles > *test_max) *test_max = logic_cycles;
+            (*test_count)++;
+
+            if (line || (board.moves_remaining == 0)) break;
+            nextPlayer(&board);
+        }
+    }
+}
+
+
+/////////////////////////////////////////////////////////////////////////////////////
+// report
+/////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct
+{
+    u32 p50;
+    u32 max;
+    double per_node;
+    double ns_per_node;
+    int over;               // searches over searchCycles (game_rules) for their nodes
+} SearchCost;
+
+static void measure(int (*search)(SearchContext*, GameBoard*), SearchLimits* limits, SearchCost* cost)
+{
+    u32 total_nodes = 0;
+    unsigned long long total_cycles = 0;
+    cost->over = 0;
+
+    for (int i=0; i<position_count; i++)
+    {
+        SearchContext context;
+        GameBoard board = positions[i];
+
+        srandom(i);
+        context.limits = *limits;
+        logic_cycles = 0;
+        search(&context, &board);
+        cycles[i] = logic_cycles;
+        total_cycles += logic_cycles;
+        total_nodes += context.nodes;
+        if (logic_cycles > searchCycles(context.nodes)) cost->over++;
+    }
+
+    // host time, the same positions and seeds again
+    double start = now();
+    for (int i=0; i<position_count; i++)
+    {
+        SearchContext context;
+        GameBoard board = positions[i];
+
+        srandom(i);
+        context.limits = *limits;
+        search(&context, &board);
+    }
+    double elapsed = now() - start;
+
+    qsort(cycles, position_count, sizeof(u32), compareU32);
+    cost->p50 = cycles[position_count / 2];
+    cost->max = cycles[position_count - 1];
+    cost->per_node = total_nodes ? (double)total_cycles / total_nodes : 0;
+    cost->ns_per_node = total_nodes ? elapsed * 1e9 / total_nodes : 0;
+}
+
+// hard as NOUGHT against easy, the starting player alternating - returns hard's wins / draws / losses
+static void playMatch(int games, int* results)
+{
+    results[0] = results[1] = results[2] = 0;
+    for (int game=0; game<games; game++)
+    {
+        GameBoard board;
+        clearBoard(&board);
+        board.current_player = game & 1 ? CROSS : NOUGHT;
+
+        while (TRUE)
+        {
+            u8 piece;
+            game_opponent = board.current_player == NOUGHT ? CPU_HARD : CPU_EASY;
+            int square = cpuMove(&board, &piece);
+
+            if (placeMove(&board, square, piece))
+            {
+                enum SQUARE_STATE winner = lineWinner(&board);
+                results[winner == NOUGHT ? 0 : 2]++;
+                break;
+            }
+            if (board.moves_remaining == 0)
+            {
+                results[1]++;
+                break;
+            }
+            nextPlayer(&board);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int wanted = argc > 1 ? atoi(argv[1]) : 4000;
+    int games = argc > 2 ? atoi(argv[2]) : 1000;
+    u32 standard_max[4] = { 0 };
+    int over_bound = 0;
+
+    if (wanted > MAX_POSITIONS) wanted = MAX_POSITIONS;
+    resetDifficultyLimits();
+    printf("%d positions of random games per variant, 68000 cycles estimated by the LOGIC_COST model\n", wanted);
+    printf("specialised - the variant's own search from game_logic.c, run time - one search looking the rules up\n\n");
+
+    printf("%-10s %-7s %9s %9s %8s %8s   %9s %9s %8s %8s   %s   %9s %5s\n", "", "", "p50 cyc", "max cyc", "cyc/node", "ns/node",
+           "p50 cyc", "max cyc", "cyc/node", "ns/node", "max / standard", "bound", "over");
+    printf("%-10s %-7s %-37s   %-37s\n", "", "", "        specialised", "        run time");
+
+    for (int v=0; v<4; v++)
+    {
+        u32 test_total, test_max;
+        int test_count;
+
+        game_rules = v;
+        srandom(v + 1);
+        collectPositions(wanted, &test_total, &test_max, &test_count);
+
+        for (int level=CPU_EASY; level<=CPU_HARD; level++)
+        {
+            SearchCost specialised, generic;
+            measure(rule_variants[v].searchMove, &difficulty_limits[level], &specialised);
+            measure(searchMoveGeneric, &difficulty_limits[level], &generic);
+            if (v == RULES_STANDARD) standard_max[level] = specialised.max;
+            u32 bound = searchWorstCase(&difficulty_limits[level]);
+            if (specialised.max > bound) specialised.over++;
+            over_bound += specialised.over;
+
+            printf("%-10s %-7s %9u %9u %8.0f %8.1f   %9u %9u %8.0f %8.1f   %14.2f   %9u %5d\n", level == CPU_EASY ? variant_names[v] : "", level_names[level],
+                   specialised.p50, specialised.max, specialised.per_node, specialised.ns_per_node,
+                   generic.p50, generic.max, generic.per_node, generic.ns_per_node, (double)specialised.max / standard_max[level], bound, specialised.over);
+        }
+
+        int results[3];
+        playMatch(games, results);
+        printf("%-10s testWin %6.0f avg %5u max cycles, hard vs easy W/D/L %5.1f%% %5.1f%% %5.1f%%\n\n", "",
+               (double)test_total / test_count, test_max,
+               results[0] * 100.0 / games, results[1] * 100.0 / games, results[2] * 100.0 / games);
+    }
+
+    if (over_bound) printf("%d searches over the worst case of game_logic.c - measure search_cycles / node_cycles again\n", over_bound);
+    return over_bound ? 1 : 0;
+}